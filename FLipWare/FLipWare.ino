@@ -48,6 +48,7 @@
 #include "parser.h"  
 #include "reporting.h"
 #include "cim.h"
+#include "binaryframes.h"
 #include "keys.h"
 #include <hardware/watchdog.h>
 
@@ -73,6 +74,15 @@ const struct SlotSettings defaultSlotSettings = {      // default slotSettings v
   2,                                // default sensorboard profile ID 2
   0x0,                              // default slot color: black
   "en_US",                          // en_US as default keyboard layout.
+  0,                                // joystick axis resolution: 10 bit
+  0, 0,                             // joystick response curves x/y: linear
+  {0, 12, 25, 37, 50, 62, 75, 87, 100}, // custom joystick response curve points (linear)
+  0, 20,                            // adaptive x/y filter: minimum cutoff (off), beta
+  0, 40,                            // tremor filter: center frequency (off), bandwidth 4 Hz
+  2, 0,                             // alternative mode auto-repeat: minimum rate, maximum rate (off)
+  0, 50, 50,                        // pressure control: mode (off), deadband, gain
+  0,                                // sip/puff onset detection: wait for settled pressure
+  {{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}},  // pressure levels: all unused
 };
 
 
@@ -90,7 +100,8 @@ struct SensorData sensorData {
 
 struct I2CSensorValues sensorValues {        
   .xRaw=0, .yRaw=0, .pressure=512, 
-  .calib_now=CALIBRATION_PERIOD     // calibrate sensors after startup !
+  .calib_now=CALIBRATION_PERIOD,    // calibrate sensors after startup !
+  .tremorFreq=0, .tremorWidth=0
 };
 
 
@@ -125,6 +136,7 @@ void setup() {
   #endif
   
   initGPIO();
+  initHID();
   initIR();
   initButtons();
   initDebouncers();
@@ -132,6 +144,8 @@ void setup() {
   initStorage();   // initialize storage if necessary
   readFromEEPROMSlotNumber(0, true); // read slot from first EEPROM slot if available !
   rp2040.fifo.push_nb(slotSettings.sb); // apply sensorboard settings
+  updateJoystickCurves(); // precalculate joystick response curves
+  updatePressureLevels(); // precalculate pressure level lookup table
 
   // NOTE: changed for RP2040!  TBD: why does setBTName damage the console UART TX ??
   // setBTName(moduleName);             // if BT-module installed: set advertising name 
@@ -143,9 +157,9 @@ void setup() {
   
 #ifdef DEBUG_OUTPUT_FULL
   #ifndef BUILD_FOR_RP2040
-    Serial.print("Free RAM:");  Serial.println(freeRam());
+    SerialOut.print("Free RAM:");  SerialOut.println(freeRam());
   #endif
-  Serial.print(moduleName); Serial.println(" ready !");
+  SerialOut.print(moduleName); SerialOut.println(" ready !");
 #endif
   lastInteractionUpdate = millis();  // get first timestamp
 
@@ -164,15 +178,19 @@ void loop() {
     return;
 	}
 
+  // type pending text, send queued keyboard reports as soon as the USB endpoint is ready / BT interval passed
+  updateKeyboardTyping();
+  serviceHIDTransports();   // perform queued USB / BT HID events
+  updateBTReports();     // send pending BT reports (keys and buttons first)
+  updateBTLink();        // BT addon baud rate negotiation
+  serviceBTTransmit();   // continue DMA transfers to the BT addon
+
   // handle incoming serial data (AT-commands)
-  while (Serial.available() > 0) {
-    // send incoming bytes to parser
-    parseByte (Serial.read());      // implemented in parser.cpp
-  }
+  processSerialInput();      // implemented in parser.cpp
   
   // if incoming data from BT-addOn: forward it to host serial interface
   while (Serial_AUX.available() > 0) {
-    Serial.write(detectBTResponse(Serial_AUX.read()));
+    handleBTInput(Serial_AUX.read());
   }
 
   // perform periodic updates  
@@ -184,8 +202,15 @@ void loop() {
     sensorData.xRaw=sensorValues.xRaw;
     sensorData.yRaw=sensorValues.yRaw;
     sensorData.pressure=sensorValues.pressure;
+    sensorData.timestamp=sensorValues.timestamp;
+    uint8_t calibrating = (sensorValues.calib_now != 0);
+    sensorValues.tremorFreq=slotSettings.tf;    // pass tremor filter settings to core1
+    sensorValues.tremorWidth=slotSettings.tw;
     mutex_exit(&(sensorValues.sensorDataMutex));
 
+    if (sensorData.calibrating && !calibrating) reportEvent(EVENT_CALIBRATION, 1, 0);
+    sensorData.calibrating = calibrating;
+
     if (StandAloneMode) {
 
       // apply rotation if needed
@@ -201,9 +226,11 @@ void loop() {
 
       calculateDirection(&sensorData);            // calculate angular direction / force form x/y sensor data
       applyDeadzone(&sensorData, &slotSettings);  // calculate updated x/y/force values according to deadzone
+      applySmoothing(&sensorData, &slotSettings); // adaptive lowpass filter for x/y values
       handleUserInteraction();                    // handle all mouse / joystick / button activities
 
       reportValues();   // send live data to serial
+      updateFrameStream();  // send live data as binary stream frames (if requested)
       updateLeds();     // mode indication via front facing neopixel LEDs
       updateBTConnectionState(); // check if BT is connected (for pairing indication LED animation)
       updateTones();    // mode indication via audio signals (buzzer)
@@ -211,7 +238,11 @@ void loop() {
     if (CimMode) {
       handleCimMode();   // create periodic reports if running in AsTeRICS CIM compatibility mode
     }
+    flushHIDReports();   // send collected USB / BT HID changes of this update
   }
+
+  // send buffered serial output (replies and telemetry) as far as the USB CDC endpoint has space
+  serviceSerialOutput();
   delay(1);  // core0: sleep a bit ...  
 }
 
@@ -38,9 +38,11 @@
 #include "infrared.h"
 #include "bluetooth.h"
 #include "hid_hal.h"
+#include "serialout.h"
 
-#define VERSION_STRING "v3.6.2"
+#define VERSION_STRING "v3.7.0"
 
+//  V3.7.0:  pressure levels (AT PZ) as buttons 20-25, reported in VALUES and AT LA only after AT RF 1
 //  V3.6.2:  added sensor information to AT ID reply, updated sensorboard profiles for piezoresistive SMD sensor board
 //  V3.6.1:  integrated support for DPS310 pressure sensor (new sip/puff daughter-board)
 //  V3.5:  reduced USB HID report frequency (fixes lost keyboard reports)
@@ -97,6 +99,9 @@
 #define MAX_KEYSTRING_LEN (WORKINGMEM_SIZE-3)   // maximum length for AT command parameters
 #define MAX_NAME_LEN  15               // maximum length for a slotname or ir name
 #define MAX_KEYSTRINGBUFFER_LEN 500    // maximum length for all string parameters of one slot
+#define JOYSTICK_CURVE_POINTS   9      // number of points for a custom joystick response curve
+#define JOYSTICK_AXIS_UNCHANGED (-32768)  // 16 bit joystick axis value which leaves the axis unchanged
+#define PRESSURE_LEVELS         6      // number of pressure levels (3 puff levels, 3 sip levels)
 
 // direction identifiers
 #define DIR_E   1   // east
@@ -117,7 +122,7 @@ struct SlotSettings {
   char slotName[MAX_NAME_LEN];   // slotname (@warning: must be always the first element, storing relies on that!)
   uint16_t keystringBufferLen;   
   
-  uint8_t  stickMode;  // alternative(0), mouse(1), joystick (2,3,4)
+  uint8_t  stickMode;  // alternative(0), mouse(1), joystick (2,3,4), scroll(5)
   uint8_t  ax;     // acceleration x
   uint8_t  ay;     // acceleration y
   int16_t  dx;     // deadzone x
@@ -138,6 +143,22 @@ struct SlotSettings {
   uint8_t  sb;     // sensorboard-profileID (0,1,2,3)
   uint32_t sc;     // slotcolor (0x: rrggbb)
   char kbdLayout[6];
+  // settings of v3.7 (not in older slot files, reset to the defaults before a slot is loaded)
+  uint8_t  jm;     // joystick axis resolution (0: 10 bit, 1: 16 bit)
+  uint8_t  cx;     // joystick response curve x (0: linear, 1-100: expo, 101-200: S-curve, 255: custom points)
+  uint8_t  cy;     // joystick response curve y (0: linear, 1-100: expo, 101-200: S-curve, 255: custom points)
+  uint8_t  cp[JOYSTICK_CURVE_POINTS];  // custom response curve: output (0-100%) for equally spaced inputs
+  uint8_t  fc;     // adaptive x/y filter: minimum cutoff frequency (in 0.1 Hz, 0: filter off)
+  uint8_t  fb;     // adaptive x/y filter: cutoff increase with movement speed (beta)
+  uint8_t  tf;     // tremor filter: center frequency (in 0.1 Hz, 0: filter off)
+  uint8_t  tw;     // tremor filter: bandwidth (in 0.1 Hz)
+  uint8_t  rn;     // alternative mode auto-repeat: minimum rate (repeats per second)
+  uint8_t  rx;     // alternative mode auto-repeat: maximum rate (repeats per second, 0: no repeat)
+  uint8_t  pa;     // pressure control: mode (0: off, 1: scroll, 2: joystick slider, 3: mouse speed)
+  uint16_t pb;     // pressure control: deadband around idle pressure (512)
+  uint8_t  pg;     // pressure control: gain
+  uint8_t  po;     // sip/puff onset detection (0: wait for settled pressure, 1: predictive)
+  uint16_t pz[PRESSURE_LEVELS][2];  // pressure levels: entry and exit pressure (puff 1-3, sip 1-3; 0: level unused)
 };
 
 /**
@@ -152,12 +173,16 @@ struct SensorData {
   int8_t autoMoveX,autoMoveY;
   int xDriftComp, yDriftComp;
   int xLocalMax, yLocalMax;  
+  uint32_t timestamp;      // time of the x/y sensor sample (micros, from core1)
+  uint8_t calibrating;     // calibration running (from core1)
 };
 
 struct I2CSensorValues {
   int xRaw,yRaw;
   int pressure;
   uint16_t calib_now;
+  uint32_t timestamp;      // time of the latest x/y sensor sample (micros)
+  uint8_t tremorFreq, tremorWidth;  // tremor filter settings (from slotSettings, applied by core1)
   mutex_t sensorDataMutex; // for synchronization of data access between cores
 };
 
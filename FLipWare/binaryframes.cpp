@@ -0,0 +1,234 @@
+/*
+     FLipWare - AsTeRICS Foundation
+     For more info please visit: https://www.asterics-foundation.org
+
+     Module: binaryframes.cpp - binary frame protocol for configuration and live values
+     (see binaryframes.h for the frame layout)
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; See the GNU General Public License:
+   http://www.gnu.org/licenses/gpl-3.0.en.html
+
+*/
+
+#include "FlipWare.h"
+#include "parser.h"
+#include "binaryframes.h"
+
+uint8_t frameParserActive = 0;
+
+uint8_t frameBuffer[FRAME_SIZE];
+uint8_t framePos = 0;
+uint32_t lastFrameByte = 0;
+
+uint16_t streamInterval = 0;     // stream interval in ms, 0: streaming off
+uint16_t streamFields = TELEMETRY_DEFAULT;
+uint32_t lastStreamFrame = 0;
+uint16_t valueSequence = 0;
+
+uint16_t calculateCRC16(const uint8_t * data, uint16_t len)
+{
+  uint16_t crc = 0xffff;
+  while (len--) {
+    crc ^= ((uint16_t)*data++) << 8;
+    for (uint8_t i = 0; i < 8; i++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return (crc);
+}
+
+/**
+   @name completeFrame
+   @brief completes a frame (sync byte, header, crc)
+   @param frame frame buffer (FRAME_SIZE bytes) with payload at position FRAME_HEADER_LEN
+   @param type frame type
+   @param seq sequence number
+   @param len payload length
+   @return none
+*/
+void completeFrame(uint8_t * frame, uint8_t type, uint8_t seq, uint8_t len)
+{
+  frame[0] = FRAME_SYNC;
+  frame[1] = type;
+  frame[2] = seq;
+  frame[3] = len;
+  memset(frame + FRAME_HEADER_LEN + len, 0, FRAME_PAYLOAD_LEN - len);
+  uint16_t crc = calculateCRC16(frame, FRAME_SIZE - 2);
+  frame[FRAME_SIZE - 2] = crc & 0xff;
+  frame[FRAME_SIZE - 1] = crc >> 8;
+}
+
+/**
+   @name sendFrame
+   @brief completes a frame and sends it as a reply (never dropped)
+   @return none
+*/
+void sendFrame(uint8_t * frame, uint8_t type, uint8_t seq, uint8_t len)
+{
+  completeFrame(frame, type, seq, len);
+  SerialOut.write(frame, FRAME_SIZE);
+  SerialOut.flush();
+}
+
+/**
+   @name putInt16 / putInt32
+   @brief store a value in little endian byte order
+*/
+static uint8_t * putInt16(uint8_t * p, int16_t val)
+{
+  *p++ = val & 0xff;
+  *p++ = (val >> 8) & 0xff;
+  return (p);
+}
+
+static uint8_t * putInt32(uint8_t * p, uint32_t val)
+{
+  p = putInt16(p, val & 0xffff);
+  return (putInt16(p, val >> 16));
+}
+
+/**
+   @name sendValueFrame
+   @brief sends the selected live values as a binary frame (see binaryframes.h for the payload)
+   @param type frame type (FRAME_REPLY_VALUES or FRAME_STREAM_VALUES)
+   @param seq sequence number of the frame
+   @param fields field mask (TELEMETRY_* bits)
+   @return none
+*/
+void sendValueFrame(uint8_t type, uint8_t seq, uint16_t fields)
+{
+  uint8_t frame[FRAME_SIZE];
+  uint8_t * p = frame + FRAME_HEADER_LEN;
+
+  fields &= TELEMETRY_ALL;
+  p = putInt16(p, valueSequence++);
+  p = putInt32(p, micros());
+  p = putInt16(p, fields);
+  if (fields & TELEMETRY_RAW_XY) {
+    p = putInt16(p, sensorData.xRaw);
+    p = putInt16(p, sensorData.yRaw);
+  }
+  if (fields & TELEMETRY_XY) {
+    p = putInt16(p, sensorData.x);
+    p = putInt16(p, sensorData.y);
+  }
+  if (fields & TELEMETRY_PRESSURE) p = putInt16(p, sensorData.pressure);
+  if (fields & TELEMETRY_FORCE)    p = putInt16(p, (int16_t)sensorData.force);
+  if (fields & TELEMETRY_ANGLE)    p = putInt16(p, (int16_t)(sensorData.angle * 1000));
+  if (fields & TELEMETRY_BUTTONS)  p = putInt32(p, buttonStates);
+  if (fields & TELEMETRY_SLOT)     *p++ = actSlot;
+  if (fields & TELEMETRY_DRIFT) {
+    p = putInt16(p, sensorData.xDriftComp);
+    p = putInt16(p, sensorData.yDriftComp);
+  }
+  if (fields & TELEMETRY_SAMPLETIME) p = putInt32(p, sensorData.timestamp);
+
+  if (type == FRAME_STREAM_VALUES) {   // stream frames are telemetry (oldest frames dropped if the host is slow)
+    completeFrame(frame, type, seq, p - (frame + FRAME_HEADER_LEN));
+    queueTelemetry(frame, FRAME_SIZE);
+  }
+  else sendFrame(frame, type, seq, p - (frame + FRAME_HEADER_LEN));
+}
+
+/**
+   @name handleFrame
+   @brief performs a received request frame and sends the reply frame
+   @return none
+*/
+void handleFrame()
+{
+  uint8_t reply[FRAME_SIZE];
+  uint8_t * payload = frameBuffer + FRAME_HEADER_LEN;
+  uint8_t type = frameBuffer[1], seq = frameBuffer[2], len = frameBuffer[3];
+  uint16_t crc = frameBuffer[FRAME_SIZE - 2] | (frameBuffer[FRAME_SIZE - 1] << 8);
+
+  if (crc != calculateCRC16(frameBuffer, FRAME_SIZE - 2)) {
+    reply[FRAME_HEADER_LEN] = FRAME_ERROR_CRC;
+    sendFrame(reply, FRAME_REPLY_ERROR, seq, 1);
+    return;
+  }
+  if (len > FRAME_PAYLOAD_LEN) {
+    reply[FRAME_HEADER_LEN] = FRAME_ERROR_LENGTH;
+    sendFrame(reply, FRAME_REPLY_ERROR, seq, 1);
+    return;
+  }
+
+  switch (type) {
+    case FRAME_PING:
+      strcpy((char *)reply + FRAME_HEADER_LEN, moduleName);
+      strcat((char *)reply + FRAME_HEADER_LEN, " " VERSION_STRING);
+      sendFrame(reply, FRAME_REPLY_PING, seq, strlen((char *)reply + FRAME_HEADER_LEN));
+      break;
+
+    case FRAME_ATCMD:
+      // reuse the AT command parser (the payload contains the command without "AT ")
+      memcpy(workingmem, payload, len);
+      workingmem[len] = 0;
+      reply[FRAME_HEADER_LEN] = parseCommand((char *)workingmem);
+      sendFrame(reply, FRAME_REPLY_ATCMD, seq, 1);
+      break;
+
+    case FRAME_VALUES:
+      sendValueFrame(FRAME_REPLY_VALUES, seq, (len >= 2) ? payload[0] | (payload[1] << 8) : TELEMETRY_DEFAULT);
+      break;
+
+    case FRAME_STREAM:
+      if (len < 2) {
+        reply[FRAME_HEADER_LEN] = FRAME_ERROR_LENGTH;
+        sendFrame(reply, FRAME_REPLY_ERROR, seq, 1);
+        break;
+      }
+      startFrameStream(payload[0] | (payload[1] << 8),
+                       (len >= 4) ? payload[2] | (payload[3] << 8) : TELEMETRY_DEFAULT);
+      putInt16(reply + FRAME_HEADER_LEN, streamInterval);
+      putInt16(reply + FRAME_HEADER_LEN + 2, streamFields);
+      sendFrame(reply, FRAME_REPLY_STREAM, seq, 4);
+      break;
+
+    default:
+      reply[FRAME_HEADER_LEN] = FRAME_ERROR_TYPE;
+      sendFrame(reply, FRAME_REPLY_ERROR, seq, 1);
+      break;
+  }
+}
+
+void parseFrameByte(int newByte)
+{
+  // an incomplete frame is dismissed after a timeout, the byte is handled by the AT command parser
+  if (framePos && (millis() - lastFrameByte > FRAME_TIMEOUT)) {
+    framePos = 0;
+    frameParserActive = 0;
+    parseByte(newByte);
+    return;
+  }
+  lastFrameByte = millis();
+  frameBuffer[framePos++] = newByte;
+
+  if (framePos == FRAME_SIZE) {
+    framePos = 0;
+    frameParserActive = 0;  // next byte: AT command or new frame
+    handleFrame();
+  }
+}
+
+void startFrameStream(uint16_t interval, uint16_t fields)
+{
+  if (interval && (interval < FRAME_MIN_INTERVAL))
+    interval = FRAME_MIN_INTERVAL;
+  streamInterval = interval;
+  streamFields = fields & TELEMETRY_ALL;
+  lastStreamFrame = millis() - interval;   // first frame with the next update
+}
+
+void updateFrameStream()
+{
+  if (!streamInterval) return;
+  if (millis() - lastStreamFrame < streamInterval) return;
+
+  lastStreamFrame = millis();
+  sendValueFrame(FRAME_STREAM_VALUES, 0, streamFields);
+}
@@ -0,0 +1,135 @@
+/*
+     FLipWare - AsTeRICS Foundation
+     For more info please visit: https://www.asterics-foundation.org
+
+     Module: binaryframes.h - binary frame protocol for configuration and live values, header file
+
+   For a list of supported AT commands, see commands.h / commands.cpp
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; See the GNU General Public License:
+   http://www.gnu.org/licenses/gpl-3.0.en.html
+
+
+   Binary Frame Layout (fixed length, all values little endian):
+   =============================================================
+
+   Sync byte          1 byte   0xA5
+   Frame type         1 byte   request / reply / stream type (see below)
+   Sequence number    1 byte   echoed in replies, incremented for stream frames
+   Payload length     1 byte   0-58
+   Payload           58 bytes  (unused bytes are 0)
+   CRC16             2 bytes   CRC16-CCITT (poly 0x1021, init 0xffff) of bytes 0-61
+   -------------------------------------------> 64 bytes
+
+   Requests and replies:
+   FRAME_PING    -> FRAME_REPLY_PING    payload: firmware version string
+   FRAME_ATCMD   -> FRAME_REPLY_ATCMD   request payload: AT command without "AT " (e.g. "MX 20")
+                                        reply payload: 1 byte result code (see parser.h)
+   FRAME_VALUES  -> FRAME_REPLY_VALUES  request payload: optional uint16 field mask
+                                        reply payload: live values (see below)
+   FRAME_STREAM  -> FRAME_REPLY_STREAM  request payload: uint16 stream interval in ms (0: stop streaming),
+                                        optional uint16 field mask; reply payload: interval, field mask
+                                        stream frames: FRAME_STREAM_VALUES, payload as FRAME_REPLY_VALUES
+   invalid frames -> FRAME_REPLY_ERROR  payload: 1 byte error code
+
+   Live values payload:
+   Sequence number    uint16   incremented for every value frame
+   Timestamp          uint32   time of frame creation (micros)
+   Field mask         uint16   fields contained in this frame, followed by the fields (in order of the bits):
+     TELEMETRY_RAW_XY       int16 xRaw, int16 yRaw
+     TELEMETRY_XY           int16 x, int16 y (after deadzone / filter)
+     TELEMETRY_PRESSURE     int16 pressure
+     TELEMETRY_FORCE        int16 force (after deadzone)
+     TELEMETRY_ANGLE        int16 angle (milliradians)
+     TELEMETRY_BUTTONS      uint32 button states (bitmask)
+     TELEMETRY_SLOT         uint8 active slot
+     TELEMETRY_DRIFT        int16 xDriftComp, int16 yDriftComp
+     TELEMETRY_SAMPLETIME   uint32 time of the sensor sample (micros, latency = timestamp - sample time)
+
+   @note Text output of AT command handlers (e.g. AT ID) is still sent as text lines.
+*/
+
+#ifndef _BINARYFRAMES_H_
+#define _BINARYFRAMES_H_
+
+#include <inttypes.h>
+
+#define FRAME_SYNC           0xA5
+#define FRAME_SIZE           64
+#define FRAME_HEADER_LEN     4
+#define FRAME_PAYLOAD_LEN    (FRAME_SIZE - FRAME_HEADER_LEN - 2)
+#define FRAME_TIMEOUT        50     // maximum time between bytes of a frame (milliseconds)
+#define FRAME_MIN_INTERVAL   UPDATE_INTERVAL   // minimum stream interval (milliseconds)
+
+#define FRAME_PING            0x01
+#define FRAME_ATCMD           0x02
+#define FRAME_VALUES          0x03
+#define FRAME_STREAM          0x04
+#define FRAME_REPLY_PING      0x81
+#define FRAME_REPLY_ATCMD     0x82
+#define FRAME_REPLY_VALUES    0x83
+#define FRAME_REPLY_STREAM    0x84
+#define FRAME_STREAM_VALUES   0x85
+#define FRAME_REPLY_ERROR     0xFF
+
+#define TELEMETRY_RAW_XY      (1 << 0)
+#define TELEMETRY_XY          (1 << 1)
+#define TELEMETRY_PRESSURE    (1 << 2)
+#define TELEMETRY_FORCE       (1 << 3)
+#define TELEMETRY_ANGLE       (1 << 4)
+#define TELEMETRY_BUTTONS     (1 << 5)
+#define TELEMETRY_SLOT        (1 << 6)
+#define TELEMETRY_DRIFT       (1 << 7)
+#define TELEMETRY_SAMPLETIME  (1 << 8)
+#define TELEMETRY_ALL         0x01ff
+#define TELEMETRY_DEFAULT     (TELEMETRY_RAW_XY | TELEMETRY_PRESSURE | TELEMETRY_BUTTONS | TELEMETRY_SLOT | TELEMETRY_DRIFT)
+
+#define FRAME_ERROR_CRC       1
+#define FRAME_ERROR_TYPE      2
+#define FRAME_ERROR_LENGTH    3
+
+/**
+   extern declaration of static variables
+   which shall be accessed from other modules
+*/
+extern uint8_t frameParserActive;
+
+/**
+   @name parseFrameByte
+   @brief collects an incoming byte of a binary frame, handles the frame when complete
+   @param newByte incoming serial byte (the first byte of a frame is FRAME_SYNC)
+   @return none
+*/
+void parseFrameByte(int newByte);
+
+/**
+   @name updateFrameStream
+   @brief sends live values as stream frames if streaming is active and the interval passed
+   @return none
+*/
+void updateFrameStream();
+
+/**
+   @name startFrameStream
+   @brief starts or stops sending live values as stream frames
+   @param interval stream interval in milliseconds (0: stop streaming)
+   @param fields field mask (TELEMETRY_* bits)
+   @return none
+*/
+void startFrameStream(uint16_t interval, uint16_t fields);
+
+/**
+   @name calculateCRC16
+   @brief calculates a CRC16-CCITT checksum (poly 0x1021, init 0xffff)
+   @param data pointer to the data
+   @param len number of bytes
+   @return the checksum
+*/
+uint16_t calculateCRC16(const uint8_t * data, uint16_t len);
+
+#endif
@@ -20,90 +20,553 @@
 #include <KeyboardLayout.h>
 //we fetch the keyboard layout map via keys.h
 #include "keys.h"
-
-#define BT_MINIMUM_SENDINTERVAL 20     // reduce mouse reports in BT mode (in milliseconds) !
+#include "reporting.h"
+#include "binaryframes.h"   // calculateCRC16
+#include <hardware/dma.h>
+#include <hardware/uart.h>
 
 static char macaddress[] = "00 00 00 00 00 00";  // len: 18
 uint8_t bt_connected = 0;
 
 uint8_t bt_available = 0;
-uint8_t activeKeyCodes[6];
+uint32_t activeKeyCodes[8];   // bitset of pressed HID key usage codes (0-255)
 uint8_t activeModifierKeys = 0;
 uint8_t activeMouseButtons = 0;
 
 //directly work in this report as it is easy & better to handle
 int8_t joystickReport[11] = {0};
 
-long btsendTimestamp = millis();
+uint32_t btsendTimestamp = 0;     // time of the last mouse report
+uint16_t btMouseInterval = BT_MOUSE_INTERVAL_DEFAULT;
+int btAccuX = 0, btAccuY = 0, btAccuScroll = 0;   // mouse movement which was not sent yet
+
+/**
+   pending reports of the BT report scheduler (see updateBTReports), with the time (micros)
+   since when they are waiting
+*/
+uint8_t btMouseButtonsPending = 0;
+uint8_t btJoystickButtonsPending = 0, btJoystickAxesPending = 0;
+uint32_t btMouseButtonsSince = 0, btMouseMoveSince = 0, btJoystickSince = 0;
 unsigned long upgradeTimestamp = 0;          // eventually come back to AT mode from an unsuccessful BT module upgrade !
 uint8_t readstate_f=0;              // needed to track the return value status during addon upgrade mode
 
+uint8_t btProtocol = BT_PROTOCOL_LEGACY;
+struct BTStatistics btStatistics = {0};
+uint8_t btFrameSequence = 0;
+uint32_t btBaudrate = BT_DEFAULT_BAUDRATE;
+
 /**
-   @name mouseBT
-   @param x relative movement x axis
-   @param y relative movement y axis
-   @param scroll relative scroll actions
-   @return
+   transmit ring for Serial_AUX: reports are copied into the ring and sent by DMA,
+   so that the BT send functions return without waiting for the UART
+*/
+uint8_t auxTxBuffer[AUX_TX_BUFFER_SIZE];
+uint16_t auxTxHead = 0, auxTxCount = 0;   // auxTxCount includes the bytes of the running DMA transfer
+uint16_t auxTxDmaLen = 0;                 // length of the running DMA transfer
+int auxTxDmaChannel = -1;
+
+/**
+   @name initAuxTx
+   @param none
+   @return none
 
-   this method sends a mouse command via the Bluetooth module.
-   Mouse movements, buttons and scroll wheel.
-   The limit for the movement is +127/-127
+   claims a DMA channel which writes to the data register of the Serial_AUX UART (paced by the UART TX DREQ)
 */
-void mouseBT(int x, int y, uint8_t scroll)
+static void initAuxTx()
 {
-  static int oldMouseButtons = 0;
-  static int accuX = 0, accuY = 0;
+  if (auxTxDmaChannel < 0) auxTxDmaChannel = dma_claim_unused_channel(false);
+  if (auxTxDmaChannel < 0) return;   // no DMA channel: Serial_AUX is written directly
+
+  dma_channel_config c = dma_channel_get_default_config(auxTxDmaChannel);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, uart_get_dreq(AUX_UART, true));
+  dma_channel_configure(auxTxDmaChannel, &c, &uart_get_hw(AUX_UART)->dr, auxTxBuffer, 0, false);
+}
 
-#ifdef DEBUG_OUTPUT_FULL
-  Serial.println("BT mouse actions:");
-  Serial.print("buttons: 0x");
-  Serial.println(activeMouseButtons, HEX);
-  Serial.print("x/y/scroll: ");
-  Serial.print(x, DEC);
-  Serial.print("/");
-  Serial.print(y, DEC);
-  Serial.print("/");
-  Serial.println(scroll, DEC);
-#endif
+void serviceBTTransmit()
+{
+  if (auxTxDmaLen) {
+    if (dma_channel_is_busy(auxTxDmaChannel)) return;
+    auxTxCount -= auxTxDmaLen;   // transfer finished
+    auxTxDmaLen = 0;
+  }
+  if (!auxTxCount) return;
 
-  accuX += x;
-  accuY += y;
+  // start the next transfer (contiguous part of the ring)
+  uint16_t tail = (auxTxHead + AUX_TX_BUFFER_SIZE - auxTxCount) % AUX_TX_BUFFER_SIZE;
+  auxTxDmaLen = AUX_TX_BUFFER_SIZE - tail;
+  if (auxTxDmaLen > auxTxCount) auxTxDmaLen = auxTxCount;
+  dma_channel_transfer_from_buffer_now(auxTxDmaChannel, auxTxBuffer + tail, auxTxDmaLen);
+}
 
-  if ((activeMouseButtons != oldMouseButtons) ||
-      ((uint32_t)abs((long int)(millis()-btsendTimestamp)) > BT_MINIMUM_SENDINTERVAL ))
-  {
-    btsendTimestamp = millis();
+/**
+   @name flushAuxTx
+   @param none
+   @return none
+
+   waits until the transmit ring was sent (e.g. before the baud rate is changed), at most for the wire time
+   of the pending data plus AUX_TX_FLUSH_MARGIN. Data which could not be sent in time is dropped.
+*/
+static void flushAuxTx()
+{
+  uint32_t start = micros();
+  uint32_t timeout = (uint32_t)auxTxCount * 10000000UL / btBaudrate + AUX_TX_FLUSH_MARGIN;
+
+  while (auxTxCount && (micros() - start < timeout)) serviceBTTransmit();
+  if (auxTxCount) {   // UART stalled
+    dma_channel_abort(auxTxDmaChannel);
+    auxTxCount = auxTxDmaLen = 0;
+    btStatistics.txOverflows++;
+  }
+  Serial_AUX.flush();
+}
+
+/**
+   @name auxWrite
+   @param data data to be sent to the BT module
+   @param len length of data
+   @return none
+
+   queues data (a complete report or command) for the BT module. If the ring is full, the data is dropped.
+*/
+static void auxWrite(const uint8_t * data, uint16_t len)
+{
+  if (auxTxDmaChannel < 0) {
+    Serial_AUX.write(data, len);
+    return;
+  }
+  serviceBTTransmit();
+  if (AUX_TX_BUFFER_SIZE - auxTxCount < len) {
+    btStatistics.txOverflows++;
+    return;
+  }
+  for (uint16_t i = 0; i < len; i++) {
+    auxTxBuffer[auxTxHead] = data[i];
+    auxTxHead = (auxTxHead + 1) % AUX_TX_BUFFER_SIZE;
+  }
+  auxTxCount += len;
+  if (auxTxCount > btStatistics.txHighWater) btStatistics.txHighWater = auxTxCount;
+  serviceBTTransmit();
+}
+
+/**
+   @name cobsEncode
+   @param src data to be encoded
+   @param len length of data
+   @param dst destination buffer (at least len + 2 bytes)
+   @return length of the encoded data (without the 0x00 frame delimiter)
+
+   consistent overhead byte stuffing: removes all 0x00 bytes from the data (0x00 is the frame delimiter)
+*/
+static uint8_t cobsEncode(const uint8_t * src, uint8_t len, uint8_t * dst)
+{
+  uint8_t codePos = 0, out = 1, code = 1;
+  for (uint8_t i = 0; i < len; i++) {
+    if (src[i]) {
+      dst[out++] = src[i];
+      code++;
+    }
+    if (!src[i] || (code == 0xff)) {
+      dst[codePos] = code;
+      codePos = out++;
+      code = 1;
+    }
+  }
+  dst[codePos] = code;
+  return (out);
+}
+
+/**
+   @name cobsDecode
+   @param buf encoded data (without delimiter), decoded in place
+   @param len length of encoded data
+   @return length of the decoded data, 0 if the data is invalid
+*/
+static uint8_t cobsDecode(uint8_t * buf, uint8_t len)
+{
+  uint8_t in = 0, out = 0;
+  while (in < len) {
+    uint8_t code = buf[in++];
+    if (!code || (in + code - 1 > len)) return (0);
+    for (uint8_t i = 1; i < code; i++) buf[out++] = buf[in++];
+    if ((code < 0xff) && (in < len)) buf[out++] = 0;
+  }
+  return (out);
+}
+
+/**
+   @name sendBTFrame
+   @param type message type (BT_MSG_*)
+   @param flags frame flags (BT_FLAG_*)
+   @param data payload
+   @param len payload length
+   @return number of bytes sent
+
+   sends a COBS encoded, CRC protected frame to the BT module
+*/
+static uint8_t sendBTFrame(uint8_t type, uint8_t flags, const uint8_t * data, uint8_t len)
+{
+  uint8_t frame[BT_FRAME_MAX];
+  uint8_t encoded[BT_FRAME_MAX + 3];
+
+  if (len > BT_FRAME_MAX - 5) return (0);
+  frame[0] = type;
+  frame[1] = btFrameSequence++;
+  frame[2] = flags;
+  memcpy(frame + 3, data, len);
+  uint16_t crc = calculateCRC16(frame, len + 3);
+  frame[len + 3] = crc & 0xff;
+  frame[len + 4] = crc >> 8;
+
+  uint8_t encodedLen = cobsEncode(frame, len + 5, encoded);
+  encoded[encodedLen++] = 0;   // frame delimiter
+  auxWrite(encoded, encodedLen);
+  if (flags & BT_FLAG_ACK_REQUEST) btStatistics.acksRequested++;
+  return (encodedLen);
+}
 
-    ///@todo refactor this code here, send more efficient mouse report data.
-    //starting RAW HID mouse report
+/**
+   @name updateBTWireTime
+   @param type message type (BT_MSG_MOUSE, BT_MSG_KEYBOARD, BT_MSG_JOYSTICK)
+   @param bytes number of bytes sent for the report
+   @return none
+
+   calculates the UART transmission time of a report (10 bits per byte) for the statistics
+*/
+static void updateBTWireTime(uint8_t type, uint8_t bytes)
+{
+  uint32_t wireTime = (uint32_t)bytes * 10000000UL / btBaudrate;
+  if ((type >= BT_MSG_MOUSE) && (type <= BT_MSG_JOYSTICK))
+    btStatistics.wireTime[type - BT_MSG_MOUSE] = wireTime;
+  btStatistics.wireTimeTotal += wireTime;
+}
+
+/**
+   @name sendBTReport
+   @param type message type (BT_MSG_MOUSE, BT_MSG_KEYBOARD, BT_MSG_JOYSTICK)
+   @param data report data
+   @param len report length
+   @return none
+
+   sends a HID report to the BT module, either framed or as legacy raw HID report (0xFD prefix)
+*/
+static void sendBTReport(uint8_t type, const uint8_t * data, uint8_t len)
+{
+  uint32_t start = micros();
+
+  btStatistics.reportsSent++;
+  if (btProtocol == BT_PROTOCOL_FRAMED) {
+    updateBTWireTime(type, sendBTFrame(type, 0, data, len));
+  }
+  else {
+    //starting RAW HID report
     //according to:
     //https://learn.adafruit.com/introducing-bluefruit-ez-key-diy-bluetooth-hid-keyboard/sending-keys-via-serial
+    uint8_t report[BT_FRAME_MAX] = {0xFD, 0x00, 0x00};
+    uint8_t headerLen = 3;
+    switch (type) {
+      case BT_MSG_MOUSE:    report[2] = 0x03; break;   // stuffing, mouse interface
+      case BT_MSG_JOYSTICK: report[2] = 0x01; break;   // stuffing, joystick interface
+      default:              headerLen = 1; break;      // keyboard: modifiers follow
+    }
+    memcpy(report + headerLen, data, len);
+    auxWrite(report, headerLen + len);
+    updateBTWireTime(type, headerLen + len);
+  }
 
-    Serial_AUX.write((uint8_t)0xFD);
+  // core0 time spent for sending reports
+  uint32_t sendTime = micros() - start;
+  if (sendTime > btStatistics.sendTimeMax) btStatistics.sendTimeMax = sendTime;
+  btStatistics.sendTimeTotal += sendTime;
+}
 
-    //stuffing...
-    Serial_AUX.write((uint8_t)0x00);
-    Serial_AUX.write((uint8_t)0x03);
+void sendBTCommand(const char * cmd)
+{
+  if (btProtocol == BT_PROTOCOL_FRAMED) {
+    sendBTFrame(BT_MSG_COMMAND, BT_FLAG_ACK_REQUEST, (const uint8_t *)cmd, strlen(cmd));
+    return;
+  }
+  // command and terminator are written together or not at all
+  uint16_t len = strlen(cmd);
+  if (auxTxDmaChannel >= 0) {
+    serviceBTTransmit();
+    if (AUX_TX_BUFFER_SIZE - auxTxCount < len + 1) {
+      btStatistics.txOverflows++;
+      return;
+    }
+  }
+  auxWrite((const uint8_t *)cmd, len);
+  auxWrite((const uint8_t *)"\n", 1); //terminate command
+}
 
-    //masked buttons:
-    //left: (1<<0)
-    //right: (1<<1)
-    //middle: (1<<2) (not sure)
-    Serial_AUX.write(activeMouseButtons);
+/**
+   baud rate negotiation (framed protocol only):
+   "$BD <baud>" proposes a baud rate, the addon replies "BAUD:OK" (both sides switch after the reply) or "BAUD:NO".
+   Then "$LT <pattern>" must be echoed as "LINKTEST:<pattern>" at the new baud rate, otherwise both sides
+   return to BT_DEFAULT_BAUDRATE (the addon after BT_LINKTEST_TIMEOUT) and the next lower rate is tried.
+   Connection polls ($GC) are held back until the negotiation is finished.
+*/
+#define BT_LINK_IDLE       0
+#define BT_LINK_PROPOSED   1
+#define BT_LINK_TESTING    2
+#define BT_LINK_DONE       3
+#define BT_LINK_SETTLING   4   // waiting for the addon to return to the default rate after a failed test
 
-    //send x/y relative movement
-    Serial_AUX.write((uint8_t)accuX);
-    Serial_AUX.write((uint8_t)accuY);
+const uint32_t btBaudrates[] = BT_BAUDRATES;
+uint8_t btLinkState = BT_LINK_IDLE;
+uint8_t btBaudIndex = 0;
+uint32_t btLinkTimestamp = 0;
 
-    //wheel. Unsupported by EZKey, but implement in our ESP32 module
-    Serial_AUX.write((uint8_t)scroll);
-    //some additional bytes...
-    Serial_AUX.write((uint8_t)0x00);
-    Serial_AUX.write((uint8_t)0x00);
+/**
+   @name setBTBaudrate
+   @param baud new baud rate for Serial_AUX
+   @return none
+*/
+static void setBTBaudrate(uint32_t baud)
+{
+  flushAuxTx();   // wait until pending data was sent
+  Serial_AUX.end();
+  Serial_AUX.begin(baud);
+  btBaudrate = baud;
+}
 
-    accuX = 0; accuY = 0;
-    oldMouseButtons = activeMouseButtons;
+/**
+   @name proposeBTBaudrate
+   @param none
+   @return none
+
+   proposes the next baud rate of the list, or stops the negotiation if all rates were tried
+*/
+static void proposeBTBaudrate()
+{
+  char cmd[16];
+  if (btBaudIndex >= sizeof(btBaudrates) / sizeof(btBaudrates[0])) {
+    btLinkState = BT_LINK_DONE;   // no faster rate: keep default
+    return;
   }
+  snprintf(cmd, sizeof(cmd), "$BD %lu", (unsigned long)btBaudrates[btBaudIndex]);
+  sendBTCommand(cmd);
+  btLinkState = BT_LINK_PROPOSED;
+  btLinkTimestamp = millis();
+}
+
+/**
+   @name failBTBaudrate
+   @param none
+   @return none
+
+   returns to the default baud rate and tries the next lower rate (after the addon returned
+   to the default rate, see updateBTLink)
+*/
+static void failBTBaudrate()
+{
+  if (btBaudrate != BT_DEFAULT_BAUDRATE) {
+    setBTBaudrate(BT_DEFAULT_BAUDRATE);
+    btLinkState = BT_LINK_SETTLING;   // addon returns to the default rate after the test timeout
+    btLinkTimestamp = millis();
+    return;
+  }
+  btBaudIndex++;
+  proposeBTBaudrate();
+}
+
+void updateBTLink()
+{
+  if ((btProtocol != BT_PROTOCOL_FRAMED) || (btLinkState == BT_LINK_DONE)) return;
+
+  switch (btLinkState) {
+    case BT_LINK_IDLE:
+      btBaudIndex = 0;
+      proposeBTBaudrate();
+      break;
+    case BT_LINK_PROPOSED:
+    case BT_LINK_TESTING:
+      if (millis() - btLinkTimestamp > BT_LINKTEST_TIMEOUT) failBTBaudrate();
+      break;
+    case BT_LINK_SETTLING:
+      if (millis() - btLinkTimestamp > BT_LINKTEST_TIMEOUT) {
+        btBaudIndex++;
+        proposeBTBaudrate();
+      }
+      break;
+  }
+}
+
+/**
+   @name handleBTReplyLine
+   @param line text reply of the BT module (without line end)
+   @return none
+
+   handles replies for the protocol and baud rate negotiation
+*/
+static void handleBTReplyLine(char * line)
+{
+  if (!strcmp(line, "FRAMED:1")) {        // a new addon acknowledges the framed protocol request
+    btProtocol = BT_PROTOCOL_FRAMED;
+    btLinkState = BT_LINK_IDLE;
+    return;
+  }
+  if (btLinkState == BT_LINK_PROPOSED) {
+    if (!strcmp(line, "BAUD:OK")) {
+      setBTBaudrate(btBaudrates[btBaudIndex]);
+      sendBTCommand("$LT " BT_LINKTEST_PATTERN);
+      btLinkState = BT_LINK_TESTING;
+      btLinkTimestamp = millis();
+    }
+    else if (!strcmp(line, "BAUD:NO")) {
+      btBaudIndex++;
+      proposeBTBaudrate();
+    }
+    return;
+  }
+  if ((btLinkState == BT_LINK_TESTING) && (!strncmp(line, "LINKTEST:", 9))) {   // other replies are ignored
+    if (!strcmp(line, "LINKTEST:" BT_LINKTEST_PATTERN)) btLinkState = BT_LINK_DONE;
+    else failBTBaudrate();
+  }
+}
+
+void handleBTInput(int c)
+{
+  static uint8_t frame[BT_FRAME_MAX];
+  static uint8_t framePos = 0;
+  static uint8_t discard = 0;   // overlong frame: ignore the rest until the next delimiter
+
+  if (btProtocol == BT_PROTOCOL_LEGACY) {
+    // collect text replies line by line (for replies which are handled by the firmware)
+    static char line[BT_REPLY_LINE_LEN];
+    static uint8_t linePos = 0;
+    if ((c == '\r') || (c == '\n')) {
+      line[linePos] = 0;
+      if (linePos) handleBTReplyLine(line);
+      linePos = 0;
+      framePos = 0;
+      discard = 0;
+    }
+    else if (linePos < BT_REPLY_LINE_LEN - 1) line[linePos++] = c;
+    SerialOut.write(detectBTResponse(c));
+    return;
+  }
+
+  if (c) {
+    if (discard) return;
+    if (framePos < BT_FRAME_MAX) frame[framePos++] = c;
+    else {
+      framePos = 0;   // overlong frame: dismiss until next delimiter
+      discard = 1;
+      btStatistics.framingErrors++;
+    }
+    return;
+  }
+
+  // frame delimiter: decode and check frame
+  if (discard) {
+    discard = 0;
+    return;
+  }
+  uint8_t len = cobsDecode(frame, framePos);
+  framePos = 0;
+  if (len < 5) {
+    if (len) btStatistics.framingErrors++;
+    return;
+  }
+  uint16_t crc = frame[len - 2] | (frame[len - 1] << 8);
+  if (crc != calculateCRC16(frame, len - 2)) {
+    btStatistics.framingErrors++;
+    return;
+  }
+
+  switch (frame[0]) {
+    case BT_MSG_STATUS:   // text reply: forward to host, detect connection state
+      for (uint8_t i = 3; i < len - 2; i++) SerialOut.write(detectBTResponse(frame[i]));
+      SerialOut.println("");
+      frame[len - 2] = 0;
+      handleBTReplyLine((char *)frame + 3);
+      break;
+    case BT_MSG_ACK:
+      btStatistics.acksReceived++;
+      break;
+  }
+}
+
+/**
+   @name saturateBTMouse
+   @param accu accumulated movement, reduced by the returned value
+   @return movement for one report (limited to +127/-127), the remainder stays in accu
+*/
+static int8_t saturateBTMouse(int &accu)
+{
+  int val = accu;
+  if (val > 127) val = 127;
+  if (val < -127) val = -127;
+  accu -= val;
+  return ((int8_t)val);
+}
+
+/**
+   @name sendBTMouseReport
+   @param none
+   @return none
+
+   sends the current mouse buttons and as much of the accumulated movement as fits into one report
+*/
+static void sendBTMouseReport()
+{
+  btsendTimestamp = millis();
+
+  //masked buttons:
+  //left: (1<<0)
+  //right: (1<<1)
+  //middle: (1<<2) (not sure)
+  //wheel: unsupported by EZKey, but implemented in our ESP32 module
+  uint8_t report[6] = {activeMouseButtons, 0x00, 0x00, 0x00, 0x00, 0x00};
+  report[1] = (uint8_t)saturateBTMouse(btAccuX);
+  report[2] = (uint8_t)saturateBTMouse(btAccuY);
+  report[3] = (uint8_t)saturateBTMouse(btAccuScroll);
+  sendBTReport(BT_MSG_MOUSE, report, sizeof(report));
+  btMouseMoveSince = micros();   // remaining movement waits for the next report
+}
+
+/**
+   @name mouseBT
+   @param x relative movement x axis
+   @param y relative movement y axis
+   @param scroll relative scroll actions
+   @return
+
+   this method collects mouse movements and scroll wheel actions for the Bluetooth module.
+   The movement is sent by updateBTReports, in steps of +127/-127 per report.
+*/
+void mouseBT(int x, int y, uint8_t scroll)
+{
+#ifdef DEBUG_OUTPUT_FULL
+  SerialOut.println("BT mouse actions:");
+  SerialOut.print("x/y/scroll: ");
+  SerialOut.print(x, DEC);
+  SerialOut.print("/");
+  SerialOut.print(y, DEC);
+  SerialOut.print("/");
+  SerialOut.println(scroll, DEC);
+#endif
+
+  if (!btAccuX && !btAccuY && !btAccuScroll) btMouseMoveSince = micros();
+  btAccuX += x;
+  btAccuY += y;
+  btAccuScroll += (int8_t)scroll;   // keep scroll steps which arrive between two reports
+}
+
+/**
+   @name queueBTMouseButtons
+   @param none
+   @return none
+
+   marks a mouse button change as pending (high priority) and passes it to the scheduler
+*/
+static void queueBTMouseButtons()
+{
+  if (!btMouseButtonsPending) btMouseButtonsSince = micros();
+  btMouseButtonsPending = 1;
+  updateBTReports();
 }
 
 /**
@@ -113,9 +576,9 @@ void mouseBT(int x, int y, uint8_t scroll)
 */
 void mouseBTPress(uint8_t mousebutton)
 {
+  if ((activeMouseButtons | mousebutton) == activeMouseButtons) return;
   activeMouseButtons |= mousebutton;
-  //update buttons without sending relative data for x/y/wheel
-  mouseBT(0, 0, 0);
+  queueBTMouseButtons();
 }
 
 /**
@@ -125,9 +588,9 @@ void mouseBTPress(uint8_t mousebutton)
 */
 void mouseBTRelease(uint8_t mousebutton)
 {
+  if (!(activeMouseButtons & mousebutton)) return;
   activeMouseButtons &= ~mousebutton;
-  //update buttons without sending relative data for x/y/wheel
-  mouseBT(0, 0, 0);
+  queueBTMouseButtons();
 }
 
 /**
@@ -148,48 +611,52 @@ boolean isMouseBTPressed(uint8_t mousebutton)
    @return none
 
    Sends a full keyboard report where all keys contained in activeKeyCodes
-   and activeModifierKeys will be sent
+   and activeModifierKeys will be sent. If more than 6 keys are pressed, the keys are
+   reported as ErrorRollOver (boot keyboard compatible 6KRO report).
 
    @todo Should we send with a different API here when upgrading to ESP32miniBT v0.2?
 */
 void sendBTKeyboardReport()
 {
+  uint8_t keys[6] = {0, 0, 0, 0, 0, 0};
+  uint8_t count = 0;
+
+  // collect pressed keys from the bitset (word by word, empty words are skipped)
+  for (uint8_t w = 0; w < 8; w++) {
+    uint32_t bits = activeKeyCodes[w];
+    while (bits) {
+      uint8_t b = __builtin_ctz(bits);
+      bits &= bits - 1;
+      if (count < 6) keys[count] = (w << 5) + b;
+      count++;
+    }
+  }
+  if (count > 6) memset(keys, KEY_ERROR_ROLLOVER, 6);   // too many keys: report phantom state
+
 #ifdef DEBUG_OUTPUT_FULL
-  Serial.println("BT keyboard actions:");
-  Serial.print("modifier: 0x");
-  Serial.println(activeModifierKeys, HEX);
-  Serial.println("activeKeyCodes: ");
-  Serial.println(activeKeyCodes[0], HEX);
-  Serial.println(activeKeyCodes[1], HEX);
-  Serial.println(activeKeyCodes[2], HEX);
-  Serial.println(activeKeyCodes[3], HEX);
-  Serial.println(activeKeyCodes[4], HEX);
-  Serial.println(activeKeyCodes[5], HEX);
+  SerialOut.println("BT keyboard actions:");
+  SerialOut.print("modifier: 0x");
+  SerialOut.println(activeModifierKeys, HEX);
+  SerialOut.println("activeKeyCodes: ");
+  for (uint8_t i = 0; i < 6; i++) SerialOut.println(keys[i], HEX);
 #endif
 
-  Serial_AUX.write((uint8_t)0xFD);       			//raw HID
-  Serial_AUX.write((uint8_t)activeModifierKeys);  	//modifier keys
-  Serial_AUX.write((uint8_t)0x00);
-  Serial_AUX.write((uint8_t)activeKeyCodes[0]);	//key 1
-  Serial_AUX.write((uint8_t)activeKeyCodes[1]);   	//key 2
-  Serial_AUX.write((uint8_t)activeKeyCodes[2]);   	//key 3
-  Serial_AUX.write((uint8_t)activeKeyCodes[3]);   	//key 4
-  Serial_AUX.write((uint8_t)activeKeyCodes[4]);   	//key 5
-  Serial_AUX.write((uint8_t)activeKeyCodes[5]);   	//key 6
+  uint8_t report[8] = {activeModifierKeys, 0x00};   //modifier keys, reserved
+  memcpy(report + 2, keys, 6);                      //key 1-6
+  sendBTReport(BT_MSG_KEYBOARD, report, sizeof(report));
 }
 
 /**
-   @name keyboardBTPress
+   @name performBTKeyPress
    @param int k	Key to be pressed
    @return none
 
-   Press a key, value is the same as in Keyboard.press().
+   Press a key and send the report, value is the same as in Keyboard.press().
    Because the Keyboard library does not export the raw keycodes or
    the full report, we copy the code of the Keyboard library to here.
 */
-void keyboardBTPress(int k)
+static void performBTKeyPress(int k)
 {
-  uint8_t currentIndex = 0;
   const uint8_t *_asciimap = getKeyboardLayout();
   if(_asciimap == 0) return; //invalid layout pointer.
   
@@ -215,27 +682,23 @@ void keyboardBTPress(int k)
     }
   }
 
-  // check the active key codes for a free slot or overwrite the last one
-  while ((activeKeyCodes[currentIndex] != 0) && (activeKeyCodes[currentIndex] != k) && (currentIndex < 6))
-    currentIndex++;
-  //set the key code to the array
-  activeKeyCodes[currentIndex] = k;
+  //set the key code in the bitset
+  if (k) activeKeyCodes[(k >> 5) & 7] |= (1UL << (k & 31));
   //send the new keyboard report
   sendBTKeyboardReport();
 }
 
 /**
-   @name keyboardBTRelease
+   @name performBTKeyRelease
    @param int k	Key to be released
    @return none
 
-   Release a key, value is the same as in Keyboard.release().
+   Release a key and send the report, value is the same as in Keyboard.release().
    Because the Keyboard library does not export the raw keycodes or
    the full report, we copy the code of the Keyboard library to here.
 */
-void keyboardBTRelease(int k)
+static void performBTKeyRelease(int k)
 {
-	uint8_t currentIndex = 0;
   const uint8_t *_asciimap = getKeyboardLayout();
   if(_asciimap == 0) return; //invalid layout pointer.
   
@@ -260,56 +723,155 @@ void keyboardBTRelease(int k)
 			k = ISO_KEY;
 		}
 	}
-  //check the active key codes for the pressed key
-  while ((activeKeyCodes[currentIndex] != k) && (currentIndex < 6)) currentIndex++;
-  //delete the key code from the array
-  for (int i = currentIndex; i < 5; i++)
-    activeKeyCodes[i] = activeKeyCodes[i + 1];
-  activeKeyCodes[5] = 0;
+  //delete the key code from the bitset
+  if (k) activeKeyCodes[(k >> 5) & 7] &= ~(1UL << (k & 31));
 
   //send the new keyboard report
   sendBTKeyboardReport();
 }
 
 /**
-   @name keyboardBTReleaseAll
+   @name performBTKeyReleaseAll
    @param none
    @return none
 
-   Release all previous pressed keyboard keys
+   Release all previous pressed keyboard keys and send the report
 */
-void keyboardBTReleaseAll()
+static void performBTKeyReleaseAll()
 {
   //reset all activeKeyCodes to 0x00
-  for (uint8_t i = 0; i <= 5; i++) activeKeyCodes[i] = 0;
+  for (uint8_t i = 0; i < 8; i++) activeKeyCodes[i] = 0;
   //reset all modifier keys
   activeModifierKeys = 0;
   //send a keyboard report (now empty)
   sendBTKeyboardReport();
 }
 
+/**
+   queue for BT keyboard actions: the addon needs some time between keyboard reports,
+   so the actions are sent time-based from updateBTReports() instead of waiting
+*/
+#define BT_KEY_ACTION_PRESS       0
+#define BT_KEY_ACTION_RELEASE     1
+#define BT_KEY_ACTION_RELEASEALL  2
+
+struct {
+  uint8_t action;
+  int16_t key;
+  uint32_t queued;   // time of queueing (micros)
+} btKeyboardQueue[BT_KEYBOARD_QUEUE_SIZE];
+uint8_t btKeyboardQueueHead = 0, btKeyboardQueueCount = 0;
+uint32_t btKeyboardTimestamp = 0;
 
 /**
-   @name keyboardBTPrint
-   @param char* writeString	string to typed by the Bluetooth HID keyboard
+   @name performBTKeyAction
+   @param none
    @return none
 
-   This method prints out an ASCII string via the
-   Bluetooth module
+   performs the oldest action of the BT keyboard queue
+*/
+static void performBTKeyAction()
+{
+  int k = btKeyboardQueue[btKeyboardQueueHead].key;
+  switch (btKeyboardQueue[btKeyboardQueueHead].action) {
+    case BT_KEY_ACTION_PRESS: performBTKeyPress(k); break;
+    case BT_KEY_ACTION_RELEASE: performBTKeyRelease(k); break;
+    case BT_KEY_ACTION_RELEASEALL: performBTKeyReleaseAll(); break;
+  }
+  btKeyboardQueueHead = (btKeyboardQueueHead + 1) % BT_KEYBOARD_QUEUE_SIZE;
+  btKeyboardQueueCount--;
+  btKeyboardTimestamp = millis();
+}
+
+/**
+   @name recordBTQueueDelay
+   @param prio priority class (BT_PRIORITY_HIGH or BT_PRIORITY_LOW)
+   @param since time since when the report was pending (micros)
+   @return none
 */
-void keyboardBTPrint(char * writeString)
+static void recordBTQueueDelay(uint8_t prio, uint32_t since)
 {
-  uint16_t i = 0;
+  uint32_t queued = micros() - since;
+  btStatistics.queuedReports[prio]++;
+  btStatistics.queueDelayTotal[prio] += queued;
+  if (queued > btStatistics.queueDelayMax[prio]) btStatistics.queueDelayMax[prio] = queued;
+}
 
-  // print each char of the string
-  while (writeString[i])
-  {
-    keyboardBTPress(writeString[i]);
-    delay(10);
-    keyboardBTRelease(writeString[i]);
-    delay(10);
-    i++;
+void sendBTJoystickReport();
+
+void updateBTReports()
+{
+  serviceBTTransmit();
+
+  // high priority: button and key state changes are sent first
+  if (btMouseButtonsPending) {
+    btMouseButtonsPending = 0;
+    recordBTQueueDelay(BT_PRIORITY_HIGH, btMouseButtonsSince);
+    sendBTMouseReport();   // together with the pending movement (so a drag starts at the right position)
+  }
+  if (btJoystickButtonsPending) {
+    btJoystickButtonsPending = btJoystickAxesPending = 0;
+    recordBTQueueDelay(BT_PRIORITY_HIGH, btJoystickSince);
+    sendBTJoystickReport();
+  }
+  if (btKeyboardQueueCount && (millis() - btKeyboardTimestamp >= BT_KEYBOARD_INTERVAL)) {
+    recordBTQueueDelay(BT_PRIORITY_HIGH, btKeyboardQueue[btKeyboardQueueHead].queued);
+    performBTKeyAction();
   }
+
+  // low priority: merged movement / axis values, only when the transmit ring is empty
+  // (so a following high priority report waits for one report at most)
+  if (auxTxCount) return;
+  if ((btAccuX || btAccuY || btAccuScroll) && (millis() - btsendTimestamp >= btMouseInterval)) {
+    // also flushes the remaining movement when the stick is idle (one report per interval)
+    recordBTQueueDelay(BT_PRIORITY_LOW, btMouseMoveSince);
+    sendBTMouseReport();
+  }
+  if (auxTxCount) return;
+  if (btJoystickAxesPending) {
+    btJoystickAxesPending = 0;
+    recordBTQueueDelay(BT_PRIORITY_LOW, btJoystickSince);
+    sendBTJoystickReport();
+  }
+}
+
+uint8_t getBTKeyboardQueueFree()
+{
+  return (BT_KEYBOARD_QUEUE_SIZE - btKeyboardQueueCount);
+}
+
+/**
+   @name queueBTKeyAction
+   @brief adds a BT keyboard action to the queue, if the queue is full the action is dropped
+          (callers check getBTKeyboardQueueFree first)
+*/
+static void queueBTKeyAction(uint8_t action, int k)
+{
+  if (btKeyboardQueueCount == BT_KEYBOARD_QUEUE_SIZE) {
+    btStatistics.keyboardDropped++;
+    return;
+  }
+  uint8_t tail = (btKeyboardQueueHead + btKeyboardQueueCount) % BT_KEYBOARD_QUEUE_SIZE;
+  btKeyboardQueue[tail].action = action;
+  btKeyboardQueue[tail].key = k;
+  btKeyboardQueue[tail].queued = micros();
+  btKeyboardQueueCount++;
+  updateBTReports();
+}
+
+void keyboardBTPress(int k)
+{
+  queueBTKeyAction(BT_KEY_ACTION_PRESS, k);
+}
+
+void keyboardBTRelease(int k)
+{
+  queueBTKeyAction(BT_KEY_ACTION_RELEASE, k);
+}
+
+void keyboardBTReleaseAll()
+{
+  queueBTKeyAction(BT_KEY_ACTION_RELEASEALL, 0);
 }
 
 /**
@@ -327,17 +889,23 @@ void keyboardBTPrint(char * writeString)
 void initBluetooth()
 {
 #ifdef DEBUG_OUTPUT_FULL
-  Serial.println("init Bluetooth");
+  SerialOut.println("init Bluetooth");
 #endif
   //start the AUX serial port 115200 8N1
   ///@note FM2 uses 9k6, ESP32 firmware must detect board and baud rate setting
-  Serial_AUX.begin(115200);
+  Serial_AUX.begin(BT_DEFAULT_BAUDRATE);
+  btBaudrate = BT_DEFAULT_BAUDRATE;
+  initAuxTx();
   
   resetBTModule(0);  // start ESP32 module!
   delay (500);
   Serial_AUX.flush();
   
   bt_available = 1;
+
+  // request the framed protocol, old addons don't reply and keep the legacy protocol
+  btProtocol = BT_PROTOCOL_LEGACY;
+  sendBTCommand("$FP");
 }
 
 /**
@@ -369,7 +937,7 @@ int detectBTResponse (int c)
     case  STATE_GET_ARGUMENT:
           macaddress[checkpos++]=(char)c;
           if (checkpos>=sizeof(macaddress)-1) {
-            // Serial.println("pairing found:"); Serial.println(macaddress);
+            // SerialOut.println("pairing found:"); SerialOut.println(macaddress);
             checkpos=0;
             bt_connected=1;
             state=STATE_FIND_MESSAGE;
@@ -391,8 +959,15 @@ void updateBTConnectionState () {
   static uint32_t timestamp=0;
   if (millis()-timestamp >= 2000)  {  // every 2 seconds
       timestamp=millis();      
+      // no polls while the baud rate is negotiated (replies would interfere with the link test)
+      if ((btProtocol == BT_PROTOCOL_FRAMED) && (btLinkState != BT_LINK_DONE)) return;
       if (isBluetoothAvailable()) {
-        Serial_AUX.write("$GC\n");
+        static uint8_t reportedConnection = 0;   // connection state of the last poll (for link up/down events)
+        if (bt_connected != reportedConnection) {
+          reportedConnection = bt_connected;
+          reportEvent(EVENT_BT, bt_connected, 0);
+        }
+        sendBTCommand("$GC");
         // digitalWrite (6,!digitalRead (6));
         bt_connected=0;  // will be updated in case the BT-module sends back connection/mac address
       }
@@ -423,8 +998,9 @@ bool isBluetoothConnected() {
 */
 void setBTName(char * BTName) {
   //set module name for BT advertising
-  Serial_AUX.print("$NAME ");
-  Serial_AUX.println(BTName);  
+  char cmd[MAX_NAME_LEN + 8];
+  snprintf(cmd, sizeof(cmd), "$NAME %s", BTName);
+  sendBTCommand(cmd);
 }
 
 /**
@@ -435,7 +1011,7 @@ void setBTName(char * BTName) {
 
 */
 void unpairAllBT() {
-  Serial_AUX.println("$DP");
+  sendBTCommand("$DP");
 }
 
 
@@ -479,8 +1055,8 @@ void performAddonUpgrade()
   //update start
   if(addonUpgrade == BTMODULE_UPGRADE_START)
   {
-    Serial_AUX.end();
-    Serial_AUX.begin(500000); //switch to higher speed...
+    setBTBaudrate(BT_UPGRADE_BAUDRATE);   // sends pending reports / commands ($UG) before the passthrough starts
+    btProtocol = BT_PROTOCOL_LEGACY;  // the upgraded addon is restarted
     Serial.flush();
     Serial_AUX.flush();
     //remove everything from buffers...
@@ -498,7 +1074,7 @@ void performAddonUpgrade()
       // 20 seconds no data -> return to AT mode !
       if((uint32_t)abs((long int)(millis()-upgradeTimestamp)) > 20000) {
         addonUpgrade = BTMODULE_UPGRADE_IDLE;
-        Serial_AUX.begin(115200); //switch to lower speed...   // NOTE: changed for RP2040! 
+        setBTBaudrate(BT_DEFAULT_BAUDRATE); //switch to lower speed...   // NOTE: changed for RP2040! 
         Serial.flush();
         Serial_AUX.flush();
         return;
@@ -525,9 +1101,10 @@ void performAddonUpgrade()
             bt_available = 1;
             readstate_f=0;
             delay(50);
-            Serial_AUX.begin(115200); //switch to lower speed...  // NOTE: changed for RP2040! 
+            setBTBaudrate(BT_DEFAULT_BAUDRATE); //switch to lower speed...  // NOTE: changed for RP2040! 
             Serial.flush();
             Serial_AUX.flush();
+            sendBTCommand("$FP");   // check if the new addon firmware supports the framed protocol
             } else readstate_f=0;
           break;
         default: 
@@ -577,17 +1154,28 @@ void resetBTModule (int downloadMode)
    @param none
    @return none
 
-   Sends the joystick report
+   Sends the joystick report (called by the scheduler, see updateBTReports)
 */
 void sendBTJoystickReport()
 {
-  Serial_AUX.write((uint8_t)0xFD); //raw HID report
-  Serial_AUX.write((uint8_t)0x00); //stuffing
-  Serial_AUX.write((uint8_t)0x01); //joystick interface
-  for(uint8_t i = 0; i<11; i++) Serial_AUX.write(joystickReport[i]);
+  sendBTReport(BT_MSG_JOYSTICK, (uint8_t *)joystickReport, sizeof(joystickReport));
 }
 
 
+/**
+   @name queueBTJoystickButtons
+   @param none
+   @return none
+
+   marks a joystick button / hat change as pending (high priority) and passes it to the scheduler
+*/
+static void queueBTJoystickButtons()
+{
+  if (!btJoystickButtonsPending && !btJoystickAxesPending) btJoystickSince = micros();
+  btJoystickButtonsPending = 1;
+  updateBTReports();
+}
+
 /**
    @name joystickBTAxis
    @param int axis1       new value for axis 1 (either X,Z or sliderLeft; set by param select)
@@ -595,7 +1183,8 @@ void sendBTJoystickReport()
    @param uint8_t select  define axis for values (0: X/Y; 1: Z/Zrotate; 2: sliderLeft/sliderRight)
    @return none
 
-   Updates axis on the Joystick report for the BT firmware. Updated report is sent.
+   Updates axis on the Joystick report for the BT firmware. The updated report is sent by
+   updateBTReports (low priority, merged with following axis updates).
 
    @note Parameter range for axis is 0-1023, but we only have int8_t ranges, so it is mapped.
    @note Axis set to -1 avoids an update of this axis
@@ -624,7 +1213,27 @@ void joystickBTAxis(int axis1, int axis2, uint8_t select)
     break;
     default: break;
   }
-  sendBTJoystickReport();
+  if (!btJoystickButtonsPending && !btJoystickAxesPending) btJoystickSince = micros();
+  btJoystickAxesPending = 1;
+}
+
+/**
+   @name joystickBTAxis16
+   @param int32_t axis1   new value for axis 1 (either X,Z or sliderLeft; set by param select)
+   @param int32_t axis2   new value for axis 2 (either Y,Zrotate or sliderRight; set by param select)
+   @param uint8_t select  define axis for values (0: X/Y; 1: Z/Zrotate; 2: sliderLeft/sliderRight)
+   @return none
+
+   Updates axis on the Joystick report for the BT firmware from 16 bit values (see joystickBTAxis).
+
+   @note Parameter range for axis is -32767 to 32767, the BT report only has int8_t axes: the 16 bit values
+         are reduced to 8 bit (-127 to 127), AT JM 1 does not increase the resolution of BT joystick reports.
+*/
+void joystickBTAxis16(int32_t axis1, int32_t axis2, uint8_t select)
+{
+  //map the axis to 0-1023, report bytes are updated as for 10 bit values (reduced to 8 bit in joystickBTAxis)
+  joystickBTAxis(axis1 == JOYSTICK_AXIS_UNCHANGED ? -1 : constrain(512 + axis1 / 64, 0, 1023),
+                 axis2 == JOYSTICK_AXIS_UNCHANGED ? -1 : constrain(512 + axis2 / 64, 0, 1023), select);
 }
 
 
@@ -650,7 +1259,7 @@ void joystickBTButton(uint8_t nr, int val)
     else *out &= ~(1<<shift);
   }
   
-  sendBTJoystickReport();
+  queueBTJoystickButtons();
 }
 
 
@@ -666,5 +1275,5 @@ void joystickBTHat(int val)
 	if(val < 0) joystickReport[6] = 0;
 	if(val >= 0 && val <= 360) joystickReport[6] = map(val,0,360,1,8);
   
-  sendBTJoystickReport();
+  queueBTJoystickButtons();
 }
@@ -23,6 +23,9 @@
 
 //RX/TX3 are used to communicate with an addon board (mounted on AUX header)
 #define Serial_AUX Serial2
+#define AUX_UART   uart1            // UART hardware of Serial_AUX (for DMA transfers)
+#define AUX_TX_BUFFER_SIZE  512     // transmit ring for Serial_AUX (bytes)
+#define AUX_TX_FLUSH_MARGIN 2000    // time allowed for flushing the transmit ring in addition to the wire time (microseconds)
 
 /** BT module upgrade: inactive/idle */
 #define BTMODULE_UPGRADE_IDLE 0
@@ -31,6 +34,79 @@
 /** BT module upgrade: running (data is transmitted) */
 #define BTMODULE_UPGRADE_RUNNING 2
 
+/** HID keyboard usage code reported in all key slots if too many keys are pressed */
+#define KEY_ERROR_ROLLOVER 0x01
+
+/** default interval of BT mouse movement reports (milliseconds), see AT BI */
+#define BT_MOUSE_INTERVAL_DEFAULT 20
+/** minimum / maximum interval of BT mouse movement reports (milliseconds) */
+#define BT_MOUSE_INTERVAL_MIN 8
+#define BT_MOUSE_INTERVAL_MAX 100
+
+/** priority classes of the BT report scheduler (see updateBTReports) */
+#define BT_PRIORITY_HIGH  0   // key and button state changes
+#define BT_PRIORITY_LOW   1   // mouse movement, joystick axes (merged into the latest value)
+
+/** number of queued BT keyboard actions */
+#define BT_KEYBOARD_QUEUE_SIZE 64
+/** minimum time between two BT keyboard reports (milliseconds) */
+#define BT_KEYBOARD_INTERVAL 10
+
+/**
+   Addon protocols:
+   legacy: raw HID reports (0xFD prefix) and "$" text commands, unframed
+   framed: COBS encoded frames, terminated by 0x00. Decoded frame:
+           message type (1 byte), sequence number (1 byte), flags (1 byte), payload, CRC16-CCITT of all previous bytes (2 bytes, little endian)
+   The framed protocol is requested with "$FP" at startup. Addons which support it reply "FRAMED:1",
+   otherwise the legacy protocol is used.
+*/
+#define BT_PROTOCOL_LEGACY   0
+#define BT_PROTOCOL_FRAMED   1
+
+#define BT_MSG_MOUSE       0x01   // payload: buttons, x, y, wheel, 0, 0
+#define BT_MSG_KEYBOARD    0x02   // payload: modifiers, 0, keycodes 1-6
+#define BT_MSG_JOYSTICK    0x03   // payload: 11 bytes joystick report
+#define BT_MSG_COMMAND     0x04   // payload: "$" text command (without line end)
+#define BT_MSG_STATUS      0x05   // from addon, payload: text reply (e.g. "CONNECTED:<mac>")
+#define BT_MSG_ACK         0x06   // from addon, payload: sequence number of the acknowledged frame
+
+#define BT_FLAG_ACK_REQUEST  0x01 // addon shall acknowledge the frame
+#define BT_FRAME_MAX         64   // maximum length of a decoded frame
+#define BT_REPLY_LINE_LEN    48   // maximum length of a text reply which is handled by the firmware
+
+#define BT_DEFAULT_BAUDRATE  115200
+#define BT_UPGRADE_BAUDRATE  500000       // baud rate of the passthrough during an addon firmware upgrade
+#define BT_BAUDRATES         {2000000, 1000000, 921600, 460800}   // baud rates tried in the negotiation (framed protocol only)
+#define BT_LINKTEST_TIMEOUT  200          // timeout for negotiation replies (milliseconds)
+#define BT_LINKTEST_PATTERN  "55AA33CC0FF0"  // test pattern which must be echoed at the new baud rate
+
+/**
+   BTStatistics struct
+   counts frames / reports sent to the BT addon (for AT ST)
+*/
+struct BTStatistics {
+  uint32_t reportsSent;
+  uint32_t acksRequested, acksReceived;
+  uint32_t framingErrors;   // received frames with invalid length or CRC
+  uint32_t wireTime[3];     // UART transmission time of the last mouse, keyboard, joystick report (microseconds)
+  uint32_t wireTimeTotal;   // UART transmission time of all reports (microseconds)
+  uint32_t txHighWater;     // maximum fill level of the transmit ring (bytes)
+  uint32_t txOverflows;     // reports / commands dropped because the transmit ring was full
+  uint32_t keyboardDropped; // keyboard actions dropped because the BT keyboard queue was full
+  uint32_t sendTimeMax, sendTimeTotal;   // core0 time spent in sending reports (microseconds)
+  uint32_t queuedReports[2];                      // reports sent by the scheduler, per priority class
+  uint32_t queueDelayMax[2], queueDelayTotal[2];  // time between a change and sending its report (microseconds)
+};
+
+/**
+   extern declaration of static variables
+   which shall be accessed from other modules
+*/
+extern uint8_t btProtocol;
+extern uint32_t btBaudrate;
+extern uint16_t btMouseInterval;
+extern struct BTStatistics btStatistics;
+
 /**
    @name mouseBT
    @param x relative movement x axis
@@ -38,9 +114,8 @@
    @param scroll relative scroll actions
    @return
 
-   this method sends a mouse command via the Bluetooth module.
-   Mouse movements, buttons and scroll wheel.
-   The limit for the movement is +127/-127
+   this method collects mouse movements and scroll wheel actions for the Bluetooth module.
+   The movement is sent by updateBTReports, in steps of +127/-127 per report.
 */
 void mouseBT(int x, int y, uint8_t scroll);
 
@@ -82,6 +157,45 @@ boolean isMouseBTPressed(uint8_t mousebutton);
 void initBluetooth();
 
 
+/**
+   @name handleBTInput
+   @param int c: incoming byte from BT module
+   @return none
+
+   handles incoming data from the BT module: text replies are forwarded to the host serial interface
+   (and checked by detectBTResponse), frames are decoded if the framed protocol is active
+*/
+void handleBTInput(int c);
+
+/**
+   @name updateBTLink
+   @param none
+   @return none
+
+   negotiates the highest baud rate which is supported by the BT module (if the framed protocol is active)
+   and verifies it with a test pattern, falls back to BT_DEFAULT_BAUDRATE. Called frequently from loop().
+*/
+void updateBTLink();
+
+/**
+   @name serviceBTTransmit
+   @param none
+   @return none
+
+   starts the next DMA transfer of the Serial_AUX transmit ring when the running transfer is finished.
+   Called frequently from loop() (and whenever data is queued).
+*/
+void serviceBTTransmit();
+
+/**
+   @name sendBTCommand
+   @param const char * cmd: "$" text command for the BT module (without line end)
+   @return none
+
+   sends a command to the BT module (as text line or as command frame, with acknowledge request)
+*/
+void sendBTCommand(const char * cmd);
+
 /**
    @name detectBTResponse
    @param int c: incoming character from BT module
@@ -123,23 +237,32 @@ void unpairAllBT();
 
 
 /**
-   @name keyboardBTPrint
-   @param char* writeString	string to typed by the Bluetooth HID keyboard
+   @name updateBTReports
+   @param none
    @return none
 
-   This method prints out an ASCII string (no modifiers available!!!) via the
-   Bluetooth module
+   BT report scheduler: sends pending reports to the BT module in order of priority.
+   High priority: mouse / joystick button changes, the next queued keyboard action (if BT_KEYBOARD_INTERVAL
+   passed since the last one). Low priority: mouse movement (if btMouseInterval passed since the last mouse report,
+   movement beyond +127/-127 is carried over) and joystick axes. Low priority reports contain the latest
+   (merged) values and are only sent when the transmit ring is empty, so clicks and keys never wait behind
+   a burst of movement reports. Called frequently from loop() and when a button changes.
+*/
+void updateBTReports();
 
-   @todo We should use the keyboard maps from ESP32, can store all of them. But how to handle any multibyte strings?
+/**
+   @name getBTKeyboardQueueFree
+   @param none
+   @return number of free entries in the BT keyboard queue
 */
-void keyboardBTPrint(char * writeString);
+uint8_t getBTKeyboardQueueFree();
 
 /**
    @name keyboardBTReleaseAll
    @param none
    @return none
 
-   Release all previous pressed keyboard keys
+   Release all previous pressed keyboard keys (queued, see updateBTReports)
 */
 void keyboardBTReleaseAll();
 
@@ -148,7 +271,7 @@ void keyboardBTReleaseAll();
    @param int k	Key to be pressed
    @return none
 
-   Press a key, value is the same as in Keyboard.press().
+   Press a key, value is the same as in Keyboard.press() (queued, see updateBTReports).
    Because the Keyboard library does not export the raw keycodes or
    the full report, we copy the code of the Keyboard library to here.
 */
@@ -159,7 +282,7 @@ void keyboardBTPress(int k);
    @param int k	Key to be released
    @return none
 
-   Release a key, value is the same as in Keyboard.release().
+   Release a key, value is the same as in Keyboard.release() (queued, see updateBTReports).
    Because the Keyboard library does not export the raw keycodes or
    the full report, we copy the code of the Keyboard library to here.
 */
@@ -230,6 +353,19 @@ void resetBTModule (int downloadMode);
 */
 void joystickBTAxis(int axis1, int axis2, uint8_t select);
 
+/**
+   @name joystickBTAxis16
+   @param int32_t axis1   new value for axis 1 (either X,Z or sliderLeft; set by param select)
+   @param int32_t axis2   new value for axis 2 (either Y,Zrotate or sliderRight; set by param select)
+   @param uint8_t select  define axis for values (0: X/Y; 1: Z/Zrotate; 2: sliderLeft/sliderRight)
+   @return none
+
+   Updates axis on the Joystick report for the BT firmware from 16 bit values (-32767 to 32767).
+
+   @note The BT joystick report has 8 bit axes, the values are reduced to 8 bit resolution.
+*/
+void joystickBTAxis16(int32_t axis1, int32_t axis2, uint8_t select);
+
 
 /**
    @name joystickBTButton
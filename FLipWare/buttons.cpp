@@ -33,8 +33,8 @@ void initButtonKeystrings()
     while (keystringBuffer[slotSettings.keystringBufferLen++]) ; 
   }
 #ifdef DEBUG_OUTPUT_FULL
-  Serial.print("Init ButtonKeystrings, bufferlen ="); 
-  Serial.println(slotSettings.keystringBufferLen);
+  SerialOut.print("Init ButtonKeystrings, bufferlen ="); 
+  SerialOut.println(slotSettings.keystringBufferLen);
 #endif
 }
 
@@ -54,10 +54,10 @@ void printKeystrings()
   char * x = keystringBuffer;
   for (int i=0;i<NUMBER_OF_BUTTONS;i++) {
     if (*x) {
-      Serial.print("Keystring ");
-      Serial.print(i);
-      Serial.print(" = ");
-      Serial.println(x);
+      SerialOut.print("Keystring ");
+      SerialOut.print(i);
+      SerialOut.print(" = ");
+      SerialOut.println(x);
       while (*x++);
     } else x++;
   }
@@ -94,7 +94,7 @@ uint16_t setButtonKeystring(uint8_t buttonIndex, char const * newKeystring)
   
 #ifdef DEBUG_OUTPUT_FULL
   printKeystrings();
-  Serial.print("bytes left:");Serial.println(MAX_KEYSTRINGBUFFER_LEN-slotSettings.keystringBufferLen);
+  SerialOut.print("bytes left:");SerialOut.println(MAX_KEYSTRINGBUFFER_LEN-slotSettings.keystringBufferLen);
 #endif
   return (MAX_KEYSTRINGBUFFER_LEN - slotSettings.keystringBufferLen);
 }
@@ -20,7 +20,8 @@
 #define _BUTTONS_H_
 
 // Constants and Macro definitions
-#define NUMBER_OF_BUTTONS  19         // number of physical + virtual switches. Note: if higher than 32, change buttonStates to uint64_t!
+#define NUMBER_OF_BUTTONS  25         // number of physical + virtual switches. Note: if higher than 32, change buttonStates to uint64_t!
+#define NUMBER_OF_LEGACY_BUTTONS 19   // buttons in the v3.6 report format (without the pressure level buttons, see AT RF)
 
 #define DEFAULT_DEBOUNCING_TIME 5   // debouncing interval for button-press / release
 
@@ -50,6 +51,13 @@
 #define STRONGPUFF_LEFT_BUTTON  17
 #define STRONGPUFF_RIGHT_BUTTON 18
 
+#define PUFF_LEVEL1_BUTTON      19    // pressure level buttons (see AT PZ), puff levels 1-3
+#define PUFF_LEVEL2_BUTTON      20
+#define PUFF_LEVEL3_BUTTON      21
+#define SIP_LEVEL1_BUTTON       22    // sip levels 1-3
+#define SIP_LEVEL2_BUTTON       23
+#define SIP_LEVEL3_BUTTON       24
+
 
 /**
    slotButtonSettings struct
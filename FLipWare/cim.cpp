@@ -75,7 +75,7 @@ unsigned int  datapos = 0;
 uint8_t first_packet = 1;
 uint8_t reports_running = 0;
 
-void parseCommand (char * cmdstr);
+uint8_t parseCommand (char * cmdstr);
 
 void init_CIM_frame (void)
 {
@@ -206,31 +206,31 @@ uint8_t process_ARE_frame(uint8_t status_code)
 
 void reply_FeatureList(void)
 {
-  Serial.write ((uint8_t *) &CIM_frame, 7);    // attention : byte alignment in struct not possible for Cortex M0 !
-  Serial.write ((uint8_t *) & (CIM_frame.cim_feature), 4);
-  Serial.write  ( (uint8_t *)&LIPMOUSE_CIM_FEATURELIST, CIM_frame.data_size);
+  SerialOut.write ((uint8_t *) &CIM_frame, 7);    // attention : byte alignment in struct not possible for Cortex M0 !
+  SerialOut.write ((uint8_t *) & (CIM_frame.cim_feature), 4);
+  SerialOut.write  ( (uint8_t *)&LIPMOUSE_CIM_FEATURELIST, CIM_frame.data_size);
 }
 
 void reply_UniqueNumber(void)
 {
   CIM_frame.data_size = 4;  // lenght of unique number
-  Serial.write ((uint8_t *) &CIM_frame, 7);    // attention : byte alignment in struct not possible for Cortex M0 !
-  Serial.write ((uint8_t *) & (CIM_frame.cim_feature), 4);
-  Serial.write ((uint8_t *) &LIPMOUSE_CIM_UNIQUE_NUMBER, CIM_frame.data_size);
+  SerialOut.write ((uint8_t *) &CIM_frame, 7);    // attention : byte alignment in struct not possible for Cortex M0 !
+  SerialOut.write ((uint8_t *) & (CIM_frame.cim_feature), 4);
+  SerialOut.write ((uint8_t *) &LIPMOUSE_CIM_UNIQUE_NUMBER, CIM_frame.data_size);
 }
 
 void reply_Acknowledge(void)
 {
   CIM_frame.data_size = 0;   // no data in ack frame
-  Serial.write ((uint8_t *) &CIM_frame, 7);    // attention : byte alignment in struct not possible for Cortex M0 !
-  Serial.write ((uint8_t *) & (CIM_frame.cim_feature), 4);
+  SerialOut.write ((uint8_t *) &CIM_frame, 7);    // attention : byte alignment in struct not possible for Cortex M0 !
+  SerialOut.write ((uint8_t *) & (CIM_frame.cim_feature), 4);
 }
 
 void reply_DataFrame(void)
 {
-  Serial.write ((uint8_t *) &CIM_frame, 7);    // attention : byte alignment in struct not possible for Cortex M0 !
-  Serial.write ((uint8_t *) & (CIM_frame.cim_feature), 4);
-  Serial.write ((uint8_t *) CIM_frame.data, CIM_frame.data_size);
+  SerialOut.write ((uint8_t *) &CIM_frame, 7);    // attention : byte alignment in struct not possible for Cortex M0 !
+  SerialOut.write ((uint8_t *) & (CIM_frame.cim_feature), 4);
+  SerialOut.write ((uint8_t *) CIM_frame.data, CIM_frame.data_size);
 }
 
 
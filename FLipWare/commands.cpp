@@ -23,6 +23,7 @@
 #include "tone.h"
 #include "modes.h"
 #include "keys.h"
+#include "binaryframes.h"
 #include "parser.h"
 #include "reporting.h"
 #include "sensors.h"
@@ -56,7 +57,13 @@ const struct atCommandType atCommands[] PROGMEM = {
   {"HM"  , PARTYPE_NONE },  {"TL"  , PARTYPE_NONE }, {"TR"  , PARTYPE_NONE }, {"TM"  , PARTYPE_NONE },
   {"KT"  , PARTYPE_STRING }, {"IH"  , PARTYPE_STRING }, {"IS"  , PARTYPE_NONE }, {"UG", PARTYPE_NONE },
   {"BC"  , PARTYPE_STRING}, {"KL"  , PARTYPE_STRING }, {"BR"  , PARTYPE_UINT }, {"RE"  , PARTYPE_NONE },
-  {"SB"  , PARTYPE_UINT },  {"SC"  , PARTYPE_STRING },
+  {"SB"  , PARTYPE_UINT },  {"SC"  , PARTYPE_STRING }, {"JM"  , PARTYPE_UINT }, {"CX"  , PARTYPE_UINT },
+  {"CY"  , PARTYPE_UINT },  {"CP"  , PARTYPE_STRING }, {"FC"  , PARTYPE_UINT }, {"FB"  , PARTYPE_UINT },
+  {"TF"  , PARTYPE_UINT },  {"TW"  , PARTYPE_UINT }, {"RN"  , PARTYPE_UINT }, {"RX"  , PARTYPE_UINT },
+  {"PA"  , PARTYPE_UINT },  {"PB"  , PARTYPE_UINT }, {"PG"  , PARTYPE_UINT }, {"PO"  , PARTYPE_UINT },
+  {"PZ"  , PARTYPE_STRING }, {"ST"  , PARTYPE_NONE },
+  {"RI"  , PARTYPE_UINT }, {"BV"  , PARTYPE_UINT }, {"QU"  , PARTYPE_STRING }, {"EV"  , PARTYPE_UINT },
+  {"BI"  , PARTYPE_UINT }, {"RF"  , PARTYPE_UINT },
 };
 
 /**
@@ -64,6 +71,7 @@ const struct atCommandType atCommands[] PROGMEM = {
 */
 const char ERRORMESSAGE_NOT_FOUND[] = "E: not found";
 const char ERRORMESSAGE_EEPROM_FULL[] = "E: eeprom full";
+const char ERRORMESSAGE_SLIDER_IN_USE[] = "E: slider used by pressure control";
 
 
 /**
@@ -73,55 +81,56 @@ const char ERRORMESSAGE_EEPROM_FULL[] = "E: eeprom full";
    @param par1 numeric parameter for the command
    @param keystring string parameter for the command
    @param periodicMouseMovement if true, mouse will continue moving after action, otherwise only one movement
-   @return none
+   @return PARSE_OK, PARSE_INVALID_PARAMETER or PARSE_COMMAND_FAILED (the error message was printed)
 */
-void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodicMouseMovement)
+uint8_t performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodicMouseMovement)
 {
   static uint8_t actButton = 0;   // to remember the button number for the button-mode-assignment AT command "AT BM"
+  uint8_t result = PARSE_OK;
   
   if (actButton != 0)  // if last command was BM (set buttonmode): store current command for this button !!
   {
 #ifdef DEBUG_OUTPUT_FULL
-    Serial.print("got new mode for button "); Serial.print(actButton); Serial.print(":");
-    Serial.print(cmd); Serial.print(","); Serial.print(par1); Serial.print(","); Serial.println(keystring);
+    SerialOut.print("got new mode for button "); SerialOut.print(actButton); SerialOut.print(":");
+    SerialOut.print(cmd); SerialOut.print(","); SerialOut.print(par1); SerialOut.print(","); SerialOut.println(keystring);
 #endif
     buttons[actButton - 1].mode = cmd;
     buttons[actButton - 1].value = par1;
-    setButtonKeystring(actButton - 1, keystring);
+    setButtonKeystring(actButton - 1, keystring ? keystring : "");   // commands without parameter pass no keystring
     actButton = 0;
-    return;  // do not actually execute the command (just store it)
+    return (PARSE_OK);  // do not actually execute the command (just store it)
   }
 
   switch (cmd) {
     case CMD_ID:
-      Serial.print(moduleName); Serial.print(" ");
-      Serial.print(VERSION_STRING); 
-      Serial.print(", PressureSensor=");
+      SerialOut.print(moduleName); SerialOut.print(" ");
+      SerialOut.print(VERSION_STRING); 
+      SerialOut.print(", PressureSensor=");
       switch (sensor_pressure) {
-        case NO_PRESSURE: Serial.print("None"); break;
-        case DPS310: Serial.print("DSP310"); break;
-        case MPRLS: Serial.print("MPRLS"); break;
-        case MPXV: Serial.print("MPXV"); break;
+        case NO_PRESSURE: SerialOut.print("None"); break;
+        case DPS310: SerialOut.print("DSP310"); break;
+        case MPRLS: SerialOut.print("MPRLS"); break;
+        case MPXV: SerialOut.print("MPXV"); break;
       }
-      Serial.print(", ForceSensor=");
+      SerialOut.print(", ForceSensor=");
       switch (sensor_force) {
-        case NO_FORCE: Serial.print("None"); break;
-        case NAU7802: Serial.print("NAU7802"); break;
+        case NO_FORCE: SerialOut.print("None"); break;
+        case NAU7802: SerialOut.print("NAU7802"); break;
       }
-      //Serial.print(", Sensorboard=");
-      //if (slotsettings.sb<SENSORBOARD_SMD_HIGH) Serial.print("StrainGauge"); 
-      //else Serial.print("SMD"); 
+      //SerialOut.print(", Sensorboard=");
+      //if (slotsettings.sb<SENSORBOARD_SMD_HIGH) SerialOut.print("StrainGauge"); 
+      //else SerialOut.print("SMD"); 
 
-      Serial.println("");
+      SerialOut.println("");
       break;
     case CMD_BM:
       release_all();
 #ifdef DEBUG_OUTPUT_FULL
-      Serial.print("set mode for button "); Serial.println(par1);
+      SerialOut.print("set mode for button "); SerialOut.println(par1);
 #endif
       if ((par1 > 0) && (par1 <= NUMBER_OF_BUTTONS))
         actButton = par1;
-      else  Serial.println("?");
+      else  SerialOut.println("?");
       break;
 
     case CMD_CL:
@@ -219,6 +228,27 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
     case CMD_JH:
       joystickHat(par1);
       break;
+    case CMD_JM:
+      slotSettings.jm = par1;
+      break;
+    case CMD_CX:
+      slotSettings.cx = par1;
+      updateJoystickCurves();
+      break;
+    case CMD_CY:
+      slotSettings.cy = par1;
+      updateJoystickCurves();
+      break;
+    case CMD_CP:
+      if (keystring) {
+        char * actpos = keystring;
+        for (int i = 0; (i < JOYSTICK_CURVE_POINTS) && (*actpos); i++) {
+          long val = strtol(actpos, &actpos, 10);
+          slotSettings.cp[i] = val < 0 ? 0 : (val > 100 ? 100 : val);
+        }
+        updateJoystickCurves();
+      }
+      break;
 
     case CMD_KW:
       if (keystring) keyboardPrint(keystring);
@@ -240,7 +270,7 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
       if(strnlen(keystring,5) == 5) {
         if(setKeyboardLayout(keystring)) {
           strncpy(slotSettings.kbdLayout, keystring, 5);
-        } else Serial.println("NOK: supported layouts: de_DE, en_US, es_ES, fr_FR, it_IT, sv_SE, da_DK");
+        } else SerialOut.println("NOK: supported layouts: de_DE, en_US, es_ES, fr_FR, it_IT, sv_SE, da_DK");
       } else { 
         printKeyboardLayout(); 
       }
@@ -254,8 +284,11 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
       if (keystring) {
         if ((strlen(keystring) > 0) && (strlen(keystring) < MAX_NAME_LEN-1)) {
           strcpy (slotSettings.slotName, keystring);  // store current slot name
-          if (saveToEEPROM(keystring)) Serial.println("OK");
-          else Serial.println(ERRORMESSAGE_EEPROM_FULL);
+          if (saveToEEPROM(keystring)) SerialOut.println("OK");
+          else {
+            SerialOut.println(ERRORMESSAGE_EEPROM_FULL);
+            result = PARSE_COMMAND_FAILED;
+          }
         }
         makeTone(TONE_INDICATE_PUFF, 0);
         
@@ -264,8 +297,11 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
     case CMD_LO:
       if (keystring) {
         release_all();
-        if (readFromEEPROM(keystring)) Serial.println("OK");
-        else Serial.println(ERRORMESSAGE_NOT_FOUND);
+        if (readFromEEPROM(keystring)) SerialOut.println("OK");
+        else {
+          SerialOut.println(ERRORMESSAGE_NOT_FOUND);
+          result = PARSE_COMMAND_FAILED;
+        }
         displayUpdate();
         setKeyboardLayout(slotSettings.kbdLayout);
       }
@@ -277,24 +313,30 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
     case CMD_LI:
       release_all();
       listSlots();
-      Serial.println("OK");  // send AT command acknowledge
+      SerialOut.println("OK");  // send AT command acknowledge
       break;
     case CMD_NE:
 #ifdef DEBUG_OUTPUT_FULL
-      Serial.print("load next slot");
+      SerialOut.print("load next slot");
 #endif
       release_all();
-      if (!readFromEEPROM("")) Serial.println(ERRORMESSAGE_NOT_FOUND);
+      if (!readFromEEPROM("")) {
+        SerialOut.println(ERRORMESSAGE_NOT_FOUND);
+        result = PARSE_COMMAND_FAILED;
+      }
       displayUpdate();
       setKeyboardLayout(slotSettings.kbdLayout);
       break;
     case CMD_DE:
 #ifdef DEBUG_OUTPUT_FULL
-      Serial.println("delete slots");
+      SerialOut.println("delete slots");
 #endif
       release_all();
-      if (deleteSlot(keystring))  Serial.println("OK");    // send AT command acknowledge      
-      else Serial.println(ERRORMESSAGE_NOT_FOUND);
+      if (deleteSlot(keystring))  SerialOut.println("OK");    // send AT command acknowledge      
+      else {
+        SerialOut.println(ERRORMESSAGE_NOT_FOUND);
+        result = PARSE_COMMAND_FAILED;
+      }
       break;
     case CMD_RS:
       deleteSlot(""); // delete all slots
@@ -303,7 +345,9 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
       saveToEEPROM(slotSettings.slotName); //save default slot to default name
       readFromEEPROM(""); //load this slot
       setKeyboardLayout(slotSettings.kbdLayout);
-      Serial.println("OK");    // send AT command acknowledge
+      updateJoystickCurves();
+      updatePressureLevels();
+      SerialOut.println("OK");    // send AT command acknowledge
       break;
     case CMD_RE:
       watchdog_reboot(0, 0, 10);
@@ -313,20 +357,28 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
       break;
 
     case CMD_MM:
+      // the left slider can either follow the stick or the pressure
+      if ((par1 == STICKMODE_JOYSTICK_SLIDERS) && (slotSettings.pa == PRESSURECONTROL_SLIDER)) {
+        SerialOut.println(ERRORMESSAGE_SLIDER_IN_USE);
+        result = PARSE_COMMAND_FAILED;
+        break;
+      }
       slotSettings.stickMode = par1;
       displayUpdate();
       
 #ifdef DEBUG_OUTPUT_FULL
       if (slotSettings.stickMode == STICKMODE_MOUSE)
-        Serial.println("mouse function activated");
+        SerialOut.println("mouse function activated");
+      else if (slotSettings.stickMode == STICKMODE_SCROLL)
+        SerialOut.println("scroll function activated");
       else if (slotSettings.stickMode >= STICKMODE_JOYSTICK_XY)
-        Serial.println("joystick function activated");
-      else Serial.println("alternative functions activated");
+        SerialOut.println("joystick function activated");
+      else SerialOut.println("alternative functions activated");
 #endif
       break;
     case CMD_SW:
 #ifdef DEBUG_OUTPUT_FULL
-      Serial.println("switch mouse / alternative function");
+      SerialOut.println("switch mouse / alternative function");
 #endif
       initBlink(6, 15);
       if (slotSettings.stickMode == STICKMODE_ALTERNATIVE)  slotSettings.stickMode = STICKMODE_MOUSE;
@@ -340,7 +392,7 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
       break;
     case CMD_CA:
 #ifdef DEBUG_OUTPUT_FULL
-      Serial.println("start calibration");
+      SerialOut.println("start calibration");
 #endif
       initBlink(10, 20);
       sensorValues.calib_now = CALIBRATION_PERIOD;
@@ -370,7 +422,7 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
         char *cmd_copy_ptr, backslash;
         uint8_t len;
 #ifdef DEBUG_OUTPUT_FULL
-        Serial.print("execute macro:"); Serial.println(keystring);
+        SerialOut.print("execute macro:"); SerialOut.println(keystring);
 #endif
 
         // do the macro stuff: feed single commands to parser, seperator: ';'
@@ -431,10 +483,83 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
       }
       else  rp2040.fifo.push_nb(par1);  // tell the other core to apply sensorboard reporting settings
       break;
+    case CMD_FC:
+      slotSettings.fc = par1;
+      break;
+    case CMD_FB:
+      slotSettings.fb = par1;
+      break;
+    case CMD_TF:
+      slotSettings.tf = par1;
+      break;
+    case CMD_TW:
+      slotSettings.tw = par1;
+      break;
+    case CMD_RN:
+      slotSettings.rn = par1;
+      break;
+    case CMD_RX:
+      slotSettings.rx = par1;
+      break;
+    case CMD_PA:
+      if ((par1 == PRESSURECONTROL_SLIDER) && (slotSettings.stickMode == STICKMODE_JOYSTICK_SLIDERS)) {
+        SerialOut.println(ERRORMESSAGE_SLIDER_IN_USE);
+        result = PARSE_COMMAND_FAILED;
+        break;
+      }
+      slotSettings.pa = par1;
+      break;
+    case CMD_PB:
+      slotSettings.pb = par1;
+      break;
+    case CMD_PG:
+      slotSettings.pg = par1;
+      break;
+    case CMD_PO:
+      slotSettings.po = par1;
+      break;
+    case CMD_PZ:
+      if (keystring) {
+        char * actpos = keystring;
+        long level = strtol(actpos, &actpos, 10);
+        long entry = strtol(actpos, &actpos, 10);
+        long exit = strtol(actpos, &actpos, 10);
+        if ((level >= 0) && (level < PRESSURE_LEVELS)) {
+          slotSettings.pz[level][0] = constrain(entry, 0L, 1023L);
+          slotSettings.pz[level][1] = constrain(exit, 0L, 1023L);
+          updatePressureLevels();
+        }
+        else {
+          SerialOut.println("?");
+          result = PARSE_INVALID_PARAMETER;
+        }
+      }
+      break;
+    case CMD_ST:
+      printStatistics();
+      break;
+    case CMD_RI:
+      reportInterval = constrain(par1, UPDATE_INTERVAL, REPORT_INTERVAL_MAX);
+      break;
+    case CMD_BV:
+      startFrameStream(par1 ? reportInterval : 0, par1);
+      break;
+    case CMD_QU:
+      printQuery(keystring);
+      break;
+    case CMD_EV:
+      eventSubscriptions = par1;
+      break;
+    case CMD_BI:
+      btMouseInterval = constrain(par1, BT_MOUSE_INTERVAL_MIN, BT_MOUSE_INTERVAL_MAX);
+      break;
+    case CMD_RF:
+      reportFormat = par1 ? REPORT_FORMAT_EXTENDED : REPORT_FORMAT_LEGACY;
+      break;
     case CMD_SC:
 #ifdef DEBUG_OUTPUT_FULL
-       Serial.print ("slot color: ");Serial.println (keystring);
-       Serial.println((uint32_t)strtol(keystring, NULL, 0));
+       SerialOut.print ("slot color: ");SerialOut.println (keystring);
+       SerialOut.println((uint32_t)strtol(keystring, NULL, 0));
 #endif
       slotSettings.sc = (uint32_t)strtol(keystring, NULL, 0);
       break;
@@ -450,7 +575,7 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
 
     case CMD_IR:
 #ifdef DEBUG_OUTPUT_FULL
-      Serial.println("record IR command");
+      SerialOut.println("record IR command");
 #endif
       if (keystring) {
         if ((strlen(keystring) > 0) && (strlen(keystring) < MAX_NAME_LEN-1))
@@ -459,14 +584,14 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
       break;
     case CMD_IP:
 #ifdef DEBUG_OUTPUT_FULL
-      Serial.println("play IR command");
+      SerialOut.println("play IR command");
 #endif
       if (keystring)
         play_IR_command(keystring);
       break;
     case CMD_IH:
 #ifdef DEBUG_OUTPUT_FULL
-      Serial.println("hold IR command");
+      SerialOut.println("hold IR command");
 #endif
       if (keystring) {
         if ((strlen(keystring) > 0) && (strlen(keystring) < MAX_NAME_LEN))
@@ -475,18 +600,21 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
       break;
     case CMD_IS:
 #ifdef DEBUG_OUTPUT_FULL
-      Serial.println("stop IR command");
+      SerialOut.println("stop IR command");
 #endif
       stop_IR_command();
       break;
     case CMD_IL:
       list_IR_commands();
-      Serial.println("OK");  // send AT command acknowledge
+      SerialOut.println("OK");  // send AT command acknowledge
       break;
     case CMD_IC:
       if (keystring) {
-        if (delete_IR_command(keystring)) Serial.println("OK");  // send AT command acknowledge
-        else Serial.println(ERRORMESSAGE_NOT_FOUND);
+        if (delete_IR_command(keystring)) SerialOut.println("OK");  // send AT command acknowledge
+        else {
+          SerialOut.println(ERRORMESSAGE_NOT_FOUND);
+          result = PARSE_COMMAND_FAILED;
+        }
       }
       break;
     case CMD_IT:
@@ -494,13 +622,12 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
       break;
     case CMD_IW:
       wipe_IR_commands();
-      Serial.println("OK");  // send AT command acknowledge
+      SerialOut.println("OK");  // send AT command acknowledge
       break;
     case CMD_BC:
       if (isBluetoothAvailable()) {
         
-        Serial_AUX.write(keystring);
-        Serial_AUX.write('\n'); //terminate command
+        sendBTCommand(keystring);
         
         //byte bf[]= {0xfd,0,3,0,5,0,0,0,0};
         //Serial_AUX.write(bf, 9); //terminate command
@@ -511,9 +638,9 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
     case CMD_UG:
       //we set this flag here, flushing & disabling serial port is done in loop()
       addonUpgrade = BTMODULE_UPGRADE_START;
-      Serial.println("Starting upgrade for BT addon!");
+      SerialOut.println("Starting upgrade for BT addon!");
       // Command for upgrade sent to ESP - triggering reset into factory reset mode
-      Serial_AUX.println("$UG");
+      sendBTCommand("$UG");
       // delaying to ensure that UART command is sent and received
       delay(500);
       break;  
@@ -521,4 +648,5 @@ void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodi
       resetBTModule (par1);
       break;
   }
+  return (result);
 }
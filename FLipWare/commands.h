@@ -8,6 +8,14 @@
    Supported AT-commands:
    (sent via serial interface, 115200 baud, using spaces between parameters.  Enter (<cr>, ASCII-code 0x0d) finishes a command)
 
+   Sequenced commands (for pipelined uploads, e.g. "#12 AT MX 10"):
+   A command line can be prefixed with "#<seq> " (seq: 0-65535, 0 restarts the sequence, otherwise seq must be last seq + 1).
+   The FLipMouse replies "NAK <seq> <code>" for failed commands (1: unknown command, 2: invalid parameter,
+   3: sequence error - command not performed, 4: command failed - e.g. slot not found, 5: command line too long)
+   and acknowledges performed commands cumulatively with "ACK <seq>"
+   (sent after each processed batch of input lines, and before a sequence error NAK), so the host can send commands
+   without waiting for each reply and resend from the last ACK after a sequence error.
+
           AT                returns "OK"
           AT ID             returns identification string (e.g. "FLipMouse V2.0")
           AT BM <uint>      puts button into programming mode (e.g. "AT BM 2" -> next AT-command defines the new function for button 2)
@@ -69,6 +77,11 @@
           AT JR <int>       release joystick button (e.g. "AT JR 2" releases joystick button 2)
           AT JH <int>       set joystick hat position (e.g. "AT JH 45" sets joystick hat to 45 degrees)
                             possible values are: 0, 45, 90, 135, 180, 225, 270, 315 and -1 to set center position)
+          AT JM <uint>      set joystick axis resolution for stick movements (0: 10 bit, 1: 16 bit; BT uses 8 bit)
+          AT CX <uint>      set joystick response curve for x axis (0: linear, 1-100: expo, 101-200: S-curve, 255: custom)
+          AT CY <uint>      set joystick response curve for y axis (0: linear, 1-100: expo, 101-200: S-curve, 255: custom)
+          AT CP <string>    set points of the custom response curve: 9 output values (0-100%) for equally spaced inputs
+                            (e.g. "AT CP 0 5 12 22 35 50 65 82 100")
 
           AT KW <string>    keyboard write string (e.g." AT KW Hello!" writes "Hello!")
           AT KP <string>    key press: press keys once (automatic release after all keys were pressed)
@@ -90,7 +103,8 @@
 
           AT SA <string>  save slotSettings and current button modes to next free eeprom slot under given name (e.g. "AT SA mouse1")
           AT LO <string>  load button modes from eeprom slot (e.g. AT LOAD mouse1 -> loads profile named "mouse1")
-          AT LA           load all slots (displays names and slotSettings of all stored slots)
+          AT LA           load all slots (displays names and slotSettings of all stored slots,
+                          button actions AT BM 01 - AT BM 19, with AT RF 1 also the pressure level buttons 20-25)
           AT LI           list all saved mode names
           AT NE           next mode will be loaded (wrap around after last slot)
           AT DE <string>  delete slot of given name (deletes all stored slots if no string parameter is given)
@@ -99,14 +113,30 @@
           AT NC           no command (idle operation)
           AT BT <uint>    set bluetooth mode, 1=USB only, 2=BT only, 3=both(default)
                           (e.g. AT BT 2 -> send HID commands only via BT if BT-daughter board is available)
+          AT BI <uint>    interval of BT mouse movement reports in milliseconds (8-100, default 20)
           AT SC <string>  change slot color: given string 0xRRGGBB                           
 
     FLipMouse-specific slotSettings and commands:
 
           AT MM <uint>    mouse mode: cursor on (uint==1) or alternative functions on (uint==0)
+                          joystick modes: X/Y (uint==2), Z/Zrotate (uint==3), sliders (uint==4)
+                          scroll mode (uint==5): vertical deflection scrolls continuously (speed set via AT AY)
           AT SW           switch between mouse cursor and alternative functions
           AT SR           start reporting raw values (5 sensor values, starting with "VALUES:")
+                          the button field has one digit per button (19, with AT RF 1: 25)
           AT ER           end reporting raw values
+          AT RI <uint>    report interval for raw values in milliseconds (8-1000, default 50)
+          AT BV <uint>    start reporting values as binary stream frames (see binaryframes.h) with the given
+                          field mask (e.g. AT BV 511 -> all fields, AT BV 0 -> stop), interval as set by AT RI
+          AT ST           print runtime statistics (e.g. sent and avoided HID reports), starting with "STATISTICS:"
+          AT QU <string>  query a setting of the current slot (e.g. AT QU AX -> "AT AX 40")
+                          or a device state (AT QU SLOT -> "SLOT 1 mouse", AT QU BTLINK -> "BTLINK 1", AT QU CALIBRATION)
+                          (button actions are not returned, unknown settings -> "?", invalid names -> "E: ...")
+          AT EV <uint>    subscribe to event messages (bitmask, 0: none), starting with "EVENT:"
+                          1: slot changed ("EVENT:SLOT <nr> <name>"), 2: calibration finished ("EVENT:CALIBRATION 1"),
+                          4: BT link up/down ("EVENT:BT <0/1>"), 8: IR command recorded ("EVENT:IR <edges> <name>")
+          AT RF <uint>    report format of AT SR and AT LA: 0 = as in v3.6, buttons 1-19 (default),
+                          1 = extended, also the pressure level buttons 20-25 (see AT PZ)
           AT CA           calibration of zeropoint
           AT AX <uint>    acceleration x-axis  (0-100)
           AT AY <uint>    acceleration y-axis  (0-100)
@@ -127,6 +157,23 @@
           AT GH <uint>    gain horizontal drift compensation (0-100)  
           AT RH <uint>    range horizontal drift compensation (0-100)
           AT SB <uint>    select a sensorboard (profile-ID), adjusts signal processing parameters (0-3)
+          AT FC <uint>    minimum cutoff frequency of adaptive x/y filter in 0.1 Hz (0: filter off, 1-255)
+          AT FB <uint>    cutoff increase of adaptive x/y filter with movement speed (0-255)
+          AT TF <uint>    center frequency of tremor filter in 0.1 Hz (0: filter off, e.g. 80 for 8 Hz)
+          AT TW <uint>    bandwidth of tremor filter in 0.1 Hz (5-255, e.g. 80 suppresses 4-12 Hz around 8 Hz)
+          AT RN <uint>    minimum auto-repeat rate in alternative mode (repeats per second, 1-125)
+          AT RX <uint>    maximum auto-repeat rate in alternative mode (repeats per second, 0: no auto-repeat, 1-125)
+                          if auto-repeat is active, the repeat rate scales with deflection (and AT AX / AT AY)
+          AT PA <uint>    continuous pressure control: 0=off, 1=scroll, 2=joystick slider (left), 3=mouse speed multiplier
+                          (puff: scroll up / slider up / faster, sip: scroll down / slider down / slower)
+                          while pressure control is on, sip/puff and strong sip/puff actions are not performed
+                          the slider can not be used together with the slider joystick mode (AT MM 4)
+          AT PB <uint>    deadband of continuous pressure control around idle pressure 512 (0-512)
+          AT PG <uint>    gain of continuous pressure control (0-255)
+          AT PO <uint>    sip/puff onset detection: 0=wait for settled pressure, 1=predictive (earlier, from pressure slope)
+          AT PZ <string>  set pressure level: index (0-2: puff levels 1-3, 3-5: sip levels 1-3), entry and exit pressure
+                          (e.g. "AT PZ 1 700 680", entry 0 = level unused). Levels act as buttons 20-25 (see AT BM)
+                          if any level is set, levels replace sip/puff and strong sip/puff actions of the slot
 
     Infrared-specific commands:
 
@@ -190,7 +237,7 @@ enum atCommands {
   CMD_IP, CMD_IC, CMD_IL, CMD_JX, CMD_JY, CMD_JZ, CMD_JT, CMD_JS, CMD_JP, CMD_JR, CMD_JH,
   CMD_IT, CMD_KH, CMD_MS, CMD_AC, CMD_MA, CMD_WA, CMD_RO, CMD_IW, CMD_BT, CMD_HL, CMD_HR, CMD_HM,
   CMD_TL, CMD_TR, CMD_TM, CMD_KT, CMD_IH, CMD_IS, CMD_UG, CMD_BC, CMD_KL, CMD_BR, CMD_RE, CMD_SB,
-  CMD_SC,
+  CMD_SC, CMD_JM, CMD_CX, CMD_CY, CMD_CP, CMD_FC, CMD_FB, CMD_TF, CMD_TW, CMD_RN, CMD_RX, CMD_PA, CMD_PB, CMD_PG, CMD_PO, CMD_PZ, CMD_ST, CMD_RI, CMD_BV, CMD_QU, CMD_EV, CMD_BI, CMD_RF,
   NUM_COMMANDS
 };
 
@@ -216,8 +263,8 @@ extern const struct atCommandType atCommands[];
    @param par1 numeric parameter for the command
    @param keystring string parameter for the command
    @param periodicMouseMovement if true, mouse will continue moving after action, otherwise only one movement
-   @return none
+   @return PARSE_OK, PARSE_INVALID_PARAMETER or PARSE_COMMAND_FAILED (see parser.h)
 */
-void performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodicMouseMovement);
+uint8_t performCommand (uint8_t cmd, int16_t par1, char * keystring, int8_t periodicMouseMovement);
 
 #endif
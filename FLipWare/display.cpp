@@ -106,6 +106,7 @@ void displayUpdate(void) {
     case 2:
     case 3:
     case 4: oled->print("Joy"); break;
+    case 5: oled->print("Scroll"); break;
   }
 
   oled->setCursor(100,3);
@@ -15,6 +15,7 @@
 */
 #include "eeprom.h"
 #include "reporting.h"
+#include "modes.h"
 #include "tone.h"
 
 #include <FS.h>
@@ -44,10 +45,10 @@ uint8_t saveToEEPROM(char const * slotname)
   } else {
     //overwrite existing one
     #ifdef DEBUG_OUTPUT_MEMORY
-      Serial.print("Overwrite Slot ");
-      Serial.print(slotname);
-      Serial.print(", slot index= ");
-      Serial.println(nr);
+      SerialOut.print("Overwrite Slot ");
+      SerialOut.print(slotname);
+      SerialOut.print(", slot index= ");
+      SerialOut.println(nr);
     #endif
     saveToEEPROMSlotNumber(nr, slotname);
   }
@@ -74,12 +75,12 @@ void saveToEEPROMSlotNumber(int8_t nr, char const * slotname)
   File f = LittleFS.open(path,"w");
 
   #ifdef DEBUG_OUTPUT_MEMORY
-    Serial.print("Start new slot: ");
-    Serial.println(path);
+    SerialOut.print("Start new slot: ");
+    SerialOut.println(path);
   #endif
   
   if (!f) {
-    Serial.println("file open failed");
+    SerialOut.println("file open failed");
     return;
   }
 
@@ -87,8 +88,8 @@ void saveToEEPROMSlotNumber(int8_t nr, char const * slotname)
   printCurrentSlot(&f);
   
   #ifdef DEBUG_OUTPUT_MEMORY
-    Serial.print("Slotsize:");
-    Serial.println(f.size());
+    SerialOut.print("Slotsize:");
+    SerialOut.println(f.size());
   #endif
   
   //finished
@@ -136,9 +137,9 @@ uint8_t readFromEEPROM(char const * slotname)
   {
     //either load next slot or first slot.
     #ifdef DEBUG_OUTPUT_MEMORY
-			Serial.print("Load next:");
-			if(actSlot == getLastSlotIndex()) Serial.println("0");
-			else Serial.println(actSlot + 1);
+			SerialOut.print("Load next:");
+			if(actSlot == getLastSlotIndex()) SerialOut.println("0");
+			else SerialOut.println(actSlot + 1);
 		#endif
     if(actSlot == getLastSlotIndex()) return readFromEEPROMSlotNumber(0, true);
     else return readFromEEPROMSlotNumber(actSlot + 1, true);
@@ -146,10 +147,10 @@ uint8_t readFromEEPROM(char const * slotname)
 
   int8_t nr = slotnameToNumber(slotname);
   #ifdef DEBUG_OUTPUT_MEMORY
-    Serial.print("Load slot ");
-    Serial.print(slotname);
-    Serial.print("@");
-    Serial.println(nr);
+    SerialOut.print("Load slot ");
+    SerialOut.print(slotname);
+    SerialOut.print("@");
+    SerialOut.println(nr);
   #endif
   //call the method which loads the data
   if (nr >= 0) return readFromEEPROMSlotNumber(nr, true);
@@ -173,8 +174,8 @@ uint8_t readFromEEPROMSlotNumber(uint8_t nr, bool playTone)
   if(!LittleFS.exists(path))
   {
     #ifdef DEBUG_OUTPUT_MEMORY
-      Serial.print(nr);
-      Serial.println(" Slot not found!");
+      SerialOut.print(nr);
+      SerialOut.println(" Slot not found!");
     #endif
     return 0;
   }
@@ -189,6 +190,11 @@ uint8_t readFromEEPROMSlotNumber(uint8_t nr, bool playTone)
   strncpy(slotSettings.slotName,name.c_str(),MAX_NAME_LEN);
   
   
+  // settings which are missing in older slot files (v3.6 and before) start with their default values
+  memcpy(&slotSettings.jm, &defaultSlotSettings.jm, sizeof(struct SlotSettings) - offsetof(struct SlotSettings, jm));
+  updateJoystickCurves();
+  updatePressureLevels();
+
   // read line by line & feed into parser
   String line = "";
   do{
@@ -202,8 +208,8 @@ uint8_t readFromEEPROMSlotNumber(uint8_t nr, bool playTone)
     //after substringing, we need at least 2 bytes: "..", e.g. "NC"
     if(line.length() < 2) break;
     #ifdef DEBUG_OUTPUT_MEMORY
-      Serial.print("Sending to parser: ");
-      Serial.println(line);
+      SerialOut.print("Sending to parser: ");
+      SerialOut.println(line);
     #endif
     parseCommand((char*)line.c_str());
   } while(line.length()>0);
@@ -212,15 +218,16 @@ uint8_t readFromEEPROMSlotNumber(uint8_t nr, bool playTone)
   f.close();
 
   #ifdef DEBUG_OUTPUT_MEMORY
-    Serial.print("read slotname "); Serial.println(slotSettings.slotName);
+    SerialOut.print("read slotname "); SerialOut.println(slotSettings.slotName);
   #endif
 
   //now next slot is active
   actSlot = nr;
 
   if (playTone) makeTone(TONE_CHANGESLOT, actSlot);
+  reportEvent(EVENT_SLOT, actSlot, slotSettings.slotName);
   #ifdef DEBUG_OUTPUT_MEMORY
-    Serial.print("actSlot: "); Serial.println(actSlot);
+    SerialOut.print("actSlot: "); SerialOut.println(actSlot);
   #endif
 
   return(1);
@@ -255,8 +262,8 @@ int8_t slotnameIRToNumber(char const * irName)
   }
   //not found
   #ifdef DEBUG_OUTPUT_MEMORY
-    Serial.print("No IR slotName found for ");
-    Serial.println(irName);
+    SerialOut.print("No IR slotName found for ");
+    SerialOut.println(irName);
   #endif
   return -1;
 }
@@ -275,7 +282,7 @@ uint8_t deleteIRCommand(char const * name)
     
   if (!strlen(name)) {
     #ifdef DEBUG_OUTPUT_MEMORY
-        Serial.println("Deleting all IR slots");
+        SerialOut.println("Deleting all IR slots");
     #endif
     
     //open ir dir
@@ -294,10 +301,10 @@ uint8_t deleteIRCommand(char const * name)
   int lastSlot= getLastIRIndex();
   
   #ifdef DEBUG_OUTPUT_MEMORY
-      Serial.print("Deleting slot ");
-      Serial.print(name);
-      Serial.print("@");
-      Serial.println(nr);   
+      SerialOut.print("Deleting slot ");
+      SerialOut.print(name);
+      SerialOut.print("@");
+      SerialOut.println(nr);   
   #endif
   
   //delete file
@@ -335,18 +342,18 @@ void saveIRToEEPROM(char * name, uint16_t *timings, uint16_t cntEdges)
 
     if (irSlot < MAX_IRCOMMANDS_IN_EERPOM) {
       #ifdef DEBUG_OUTPUT_MEMORY
-        Serial.print("New IR command @");
-        Serial.println(irSlot);
+        SerialOut.print("New IR command @");
+        SerialOut.println(irSlot);
       #endif
       saveIRToEEPROMSlotNumber(irSlot, name, timings, cntEdges);
-    } else Serial.println ("IR memory full, code not saved.");
+    } else SerialOut.println ("IR memory full, code not saved.");
   }
   else {
     #ifdef DEBUG_OUTPUT_MEMORY
-      Serial.print("Overwrite IR Slot ");
-      Serial.print(name);
-      Serial.print(" at position ");
-      Serial.println(nr);
+      SerialOut.print("Overwrite IR Slot ");
+      SerialOut.print(name);
+      SerialOut.print(" at position ");
+      SerialOut.println(nr);
     #endif
     saveIRToEEPROMSlotNumber(nr, name, timings, cntEdges);
   }
@@ -364,8 +371,8 @@ void saveIRToEEPROMSlotNumber(uint8_t nr, char * name, uint16_t *timings, uint16
   #ifdef DEBUG_OUTPUT_MEMORY
     //determine the size of this slot
     size_t size = sizeof (irCommand) + cntEdges * 2;
-    Serial.print("IR slot size:");
-    Serial.println(size);
+    SerialOut.print("IR slot size:");
+    SerialOut.println(size);
   #endif
   
   /** save this slot **/
@@ -374,12 +381,12 @@ void saveIRToEEPROMSlotNumber(uint8_t nr, char * name, uint16_t *timings, uint16
   File f = LittleFS.open(path,"w");
 
   #ifdef DEBUG_OUTPUT_MEMORY
-    Serial.print("Start new slot: ");
-    Serial.println(path);
+    SerialOut.print("Start new slot: ");
+    SerialOut.println(path);
   #endif
   
   if (!f) {
-    Serial.println("file open failed");
+    SerialOut.println("file open failed");
     return;
   }
   
@@ -407,14 +414,14 @@ uint16_t readIRFromEEPROM(char * name, uint16_t *timings, uint16_t maxEdges)
 
   if (nr < 0) {
     #ifdef DEBUG_OUTPUT_FULL
-      Serial.print("Could not find IR command ");
-      Serial.println(name);
+      SerialOut.print("Could not find IR command ");
+      SerialOut.println(name);
     #endif
     return 0;
   }
   #ifdef DEBUG_OUTPUT_MEMORY
-    Serial.print("Load IR command by nr: ");
-    Serial.print(nr);
+    SerialOut.print("Load IR command by nr: ");
+    SerialOut.print(nr);
   #endif
   
   char path[32];
@@ -423,8 +430,8 @@ uint16_t readIRFromEEPROM(char * name, uint16_t *timings, uint16_t maxEdges)
   if(!LittleFS.exists(path))
   {
     #ifdef DEBUG_OUTPUT_MEMORY
-      Serial.print(nr);
-      Serial.println(" IRcmd not found!");
+      SerialOut.print(nr);
+      SerialOut.println(" IRcmd not found!");
     #endif
     return 0;
   }
@@ -436,8 +443,8 @@ uint16_t readIRFromEEPROM(char * name, uint16_t *timings, uint16_t maxEdges)
   // load the general ircmd struct, containing the name
   f.readBytes((char *)&irCommand, sizeof(irCommandHeader));
   #ifdef DEBUG_OUTPUT_MEMORY
-    Serial.print("read slotname "); Serial.println(irCommand.irName);
-    Serial.print("edge count "); Serial.println(irCommand.edges);
+    SerialOut.print("read slotname "); SerialOut.println(irCommand.irName);
+    SerialOut.print("edge count "); SerialOut.println(irCommand.edges);
   #endif
   
   if(irCommand.edges > maxEdges) {
@@ -465,10 +472,10 @@ void initStorage()
   // check if we need to initialize FS (/rev.bin not found)
   if (!LittleFS.exists("/rev.bin")) {
     makeTone(TONE_CHANGESLOT, 4);
-    Serial.println("Initializing flash!");
+    SerialOut.println("Initializing flash!");
     File f = LittleFS.open("/rev.bin", "w");
     if (!f) {
-        Serial.println("file open failed");
+        SerialOut.println("file open failed");
     } else {
       f.println(VERSION_STRING);
       f.close();
@@ -498,7 +505,7 @@ uint8_t deleteSlot(char const * name)
   
   if (!strlen(name)) {
     #ifdef DEBUG_OUTPUT_MEMORY
-        Serial.println("Deleting all slots");
+        SerialOut.println("Deleting all slots");
     #endif
   
     //open current dir
@@ -512,8 +519,8 @@ uint8_t deleteSlot(char const * name)
   }
 
   #ifdef DEBUG_OUTPUT_MEMORY
-    Serial.print("Deleting slot ");
-    Serial.println(name);      
+    SerialOut.print("Deleting slot ");
+    SerialOut.println(name);      
   #endif
   
   int8_t nr = slotnameToNumber(name);
@@ -557,8 +564,8 @@ void listSlots()
       String slotname = f.readStringUntil('\n');
       slotname.trim();
       f.close();
-      Serial.print("Slot"); Serial.print(i); Serial.print(":");
-      Serial.println(slotname);
+      SerialOut.print("Slot"); SerialOut.print(i); SerialOut.print(":");
+      SerialOut.println(slotname);
     } else return;
   }
 }
@@ -580,8 +587,8 @@ void listIRCommands()
       //read slotname
       String slotname = f.readStringUntil(0);
       f.close();
-      Serial.print("IRCommand"); Serial.print(i); Serial.print(":");
-      Serial.println(slotname);
+      SerialOut.print("IRCommand"); SerialOut.print(i); SerialOut.print(":");
+      SerialOut.println(slotname);
     } else return;
   }
 }
@@ -615,25 +622,53 @@ int8_t getLastIRIndex(void) {
 
 
 
+/**
+   state of the slot dump (AT LA), which is printed line by line as the host reads it
+   (see setSerialOutputProducer)
+ * */
+File slotDumpFile;
+uint8_t slotDumpSlot = 0, slotDumpSkip = 0;
+
+/**
+   prints the next line of the slot dump. In the v3.6 report format the actions of the pressure level
+   buttons ("AT BM 20" - "AT BM 25" and the following command line) are left out.
+   returns 0 when the dump is complete
+ * */
+static uint8_t printSlotDumpLine(void)
+{
+  char path[32];
+
+  while ((!slotDumpFile) || (!slotDumpFile.available())) {
+    if (slotDumpFile) slotDumpFile.close();
+    if (slotDumpSlot >= MAX_SLOTS_IN_EERPOM) {
+      SerialOut.println("END");
+      return (0);
+    }
+    sprintf(path, "/%03d/%02d", getSettingsRevision(), slotDumpSlot++);
+    slotDumpFile = LittleFS.open(path, "r");
+    if (!slotDumpFile) slotDumpSlot = MAX_SLOTS_IN_EERPOM;   // slots are numbered without gaps
+    else SerialOut.print("Slot:");
+  }
+
+  String line = slotDumpFile.readStringUntil('\n');
+  if ((reportFormat != REPORT_FORMAT_EXTENDED) && (!strncmp(line.c_str(), "AT BM ", 6)) &&
+      (atoi(line.c_str() + 6) > NUMBER_OF_LEGACY_BUTTONS)) slotDumpSkip = 2;
+  if (slotDumpSkip) slotDumpSkip--;
+  else {
+    SerialOut.print(line);
+    SerialOut.print("\n");
+  }
+  return (1);
+}
+
 /**
    print all slot slotSettings and button mode to serial 
  * */
 void printAllSlots(void) {
-  char path[32];
-  uint8_t revision = getSettingsRevision(); //determine current settings revision number
-  
-  for(uint8_t i = 0; i<MAX_SLOTS_IN_EERPOM; i++)
-  {
-	  sprintf(path,"/%03d/%02d",revision,i);
-	  File f = LittleFS.open(path,"r");
-	  if(f)
-	  {
-		  String slot = f.readString();
-		  Serial.print("Slot"); Serial.print(":");
-		  Serial.print(slot);
-	  } else break;
-	}
-	Serial.println("END");
+  if (slotDumpFile) slotDumpFile.close();
+  slotDumpSlot = 0;
+  slotDumpSkip = 0;
+  setSerialOutputProducer(printSlotDumpLine);
 }
 
 /**
@@ -123,6 +123,7 @@ int8_t getLastIRIndex(void);
 
 /**
    Print out all slot data  to the serial interface
+   (line by line as the host reads it, serial commands wait until "END" was printed)
  * */
 void printAllSlots(void);
 
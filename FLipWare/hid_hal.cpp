@@ -14,50 +14,445 @@
 */
 
 #include "hid_hal.h"
+#include "keys.h"
+#include <KeyboardLayout.h>
+#include <tusb.h>
 
 uint8_t dragRecordingState=DRAG_RECORDING_IDLE;
 int16_t dragRecordingX=0;
 int16_t dragRecordingY=0;
 
-void mouseRelease(uint8_t button)
+/**
+   HID transports: every HID action is passed to the transports which are selected by slotSettings.bt
+   (fan-out). Each transport has its own event queue for discrete events (buttons, keys) and its own
+   pending state for continuous values (mouse movement, joystick axes), which are merged until the transport
+   sends them. So a slow transport (e.g. the BT UART) can't delay the reports of the other one.
+   USB: queued events are performed while the HID endpoint is ready, movement and joystick changes
+        are sent with one report per interface in flushHIDReports().
+   BT:  queued events are passed to the BT module while its keyboard queue has space, movement and
+        joystick changes are passed in flushHIDReports() (the BT report scheduler sends them, see updateBTReports).
+*/
+#define HID_EVENT_MOUSE_PRESS       0
+#define HID_EVENT_MOUSE_RELEASE     1
+#define HID_EVENT_MOUSE_TOGGLE      2
+#define HID_EVENT_KEY_PRESS         3
+#define HID_EVENT_KEY_RELEASE       4
+#define HID_EVENT_KEY_RELEASEALL    5
+#define HID_EVENT_JOYSTICK_BUTTON   6
+#define HID_EVENT_JOYSTICK_HAT      7
+#define HID_EVENT_RELEASEALL        8   // releases all keys and buttons (replaces queued releases on overflow)
+
+struct HIDEvent {
+  uint8_t type, param;
+  int16_t value;
+  uint32_t timestamp;   // time of the HID action (micros)
+};
+
+struct HIDTransport {
+  struct HIDEvent queue[HID_EVENT_QUEUE_SIZE];
+  uint8_t queueHead, queueCount;
+  int32_t mouseX, mouseY, mouseWheel;   // pending movement
+  uint16_t mouseUpdates;                // movement updates merged into the pending movement
+  uint32_t mouseSince;                  // time of the first pending movement update (micros)
+  uint8_t axesChanged;                  // changed joystick axes (bitmask, index as in joystickState.axis)
+  uint16_t joystickUpdates;             // joystick updates since the last flush
+  uint32_t joystickSince;
+} hidTransports[HID_TRANSPORTS];
+
+struct HIDStatistics hidStatistics = {0};
+struct HIDTransportStatistics hidTransportStatistics[HID_TRANSPORTS] = {0};
+uint8_t hidRouting = 0;       // transports selected for HID actions (bitmask, updated in serviceHIDTransports)
+uint8_t joystickChanged = 0;  // USB joystick report must be sent
+uint8_t usbFlushDeferred = 0; // USB endpoint was busy in flushHIDReports: retry in serviceHIDTransports
+
+/**
+   joystick state (transport independent, for detecting changes; axis order: X, Y, Z, Zrotate, sliderLeft, sliderRight)
+   All axes are stored as 16 bit values (-32767 to 32767), 10 bit values are converted by joystickAxis.
+*/
+struct {
+  int32_t axis[6];
+  uint32_t buttons;
+  int hat;
+} joystickState = {{0, 0, 0, 0, 0, 0}, 0, -1};
+
+/**
+   @name recordHIDLatency
+   @brief counts a report / event passed to a transport and the time since the HID action
+*/
+static void recordHIDLatency(uint8_t t, uint32_t since)
+{
+  uint32_t latency = micros() - since;
+  hidTransportStatistics[t].sent++;
+  hidTransportStatistics[t].latencyTotal += latency;
+  if (latency > hidTransportStatistics[t].latencyMax) hidTransportStatistics[t].latencyMax = latency;
+}
+
+/**
+   @name flushUSBMouse
+   @brief sends one USB mouse report with the pending movement (values exceeding the report range are carried over)
+          If the HID endpoint is busy, the movement is kept for the next pass.
+*/
+static void flushUSBMouse()
 {
-  if (slotSettings.bt & 1)
-    Mouse.release(button);
+  struct HIDTransport * tr = &hidTransports[HID_TRANSPORT_USB];
 
-  if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-    mouseBTRelease(button);
+  if (tr->mouseX || tr->mouseY || tr->mouseWheel) {
+    if (!tud_hid_ready()) {   // the report would be dropped
+      usbFlushDeferred = 1;
+      return;
+    }
+    int8_t x = constrain(tr->mouseX, -127, 127);
+    int8_t y = constrain(tr->mouseY, -127, 127);
+    int8_t wheel = constrain(tr->mouseWheel, -127, 127);
+    Mouse.move(x, y, wheel);
+    tr->mouseX -= x; tr->mouseY -= y; tr->mouseWheel -= wheel;
+    hidStatistics.mouseReports++;
+    recordHIDLatency(HID_TRANSPORT_USB, tr->mouseSince);
+    if (tr->mouseUpdates > 1) {
+      hidStatistics.mouseAvoided += tr->mouseUpdates - 1;
+      hidTransportStatistics[HID_TRANSPORT_USB].merged += tr->mouseUpdates - 1;
+    }
+  }
+  else hidStatistics.mouseAvoided += tr->mouseUpdates;  // no resulting movement
+  tr->mouseUpdates = 0;
+  tr->mouseSince = micros();   // remaining movement: next report
 }
 
-void mousePress(uint8_t button)
+/**
+   @name flushUSBJoystick
+   @brief sends the USB joystick report if the joystick state changed
+          If the HID endpoint is busy, the changes are kept for the next pass.
+*/
+static void flushUSBJoystick()
+{
+  struct HIDTransport * tr = &hidTransports[HID_TRANSPORT_USB];
+
+  if (!tr->axesChanged && !joystickChanged) {
+    hidStatistics.joystickAvoided += tr->joystickUpdates;  // no change
+    tr->joystickUpdates = 0;
+    return;
+  }
+  if (!tud_hid_ready()) {   // the report would be dropped
+    usbFlushDeferred = 1;
+    return;
+  }
+
+  if (tr->axesChanged) {
+    for (uint8_t i = 0; i < 6; i++) {
+      if (!(tr->axesChanged & (1 << i))) continue;
+      int32_t val = joystickState.axis[i];
+      switch (i) {
+        case 0: Joystick.X(val); break;
+        case 1: Joystick.Y(val); break;
+        case 2: Joystick.Z(val); break;
+        case 3: Joystick.Zrotate(val); break;
+        case 4: Joystick.sliderLeft(val); break;
+        case 5: Joystick.sliderRight(val); break;
+      }
+    }
+    tr->axesChanged = 0;
+    joystickChanged = 1;
+  }
+
+  Joystick.send_now();
+  hidStatistics.joystickReports++;
+  recordHIDLatency(HID_TRANSPORT_USB, tr->joystickSince);
+  if (tr->joystickUpdates > 1) {
+    hidStatistics.joystickAvoided += tr->joystickUpdates - 1;
+    hidTransportStatistics[HID_TRANSPORT_USB].merged += tr->joystickUpdates - 1;
+  }
+  joystickChanged = 0;
+  tr->joystickUpdates = 0;
+}
+
+/**
+   @name performUSBEvent
+   @brief performs a queued event on the USB HID interfaces
+   @return 0 if the event must be performed again (pending movement was sent first), 1 otherwise
+*/
+static uint8_t performUSBEvent(struct HIDEvent * ev)
 {
-  if (slotSettings.bt & 1)
-    Mouse.press(button);
+  struct HIDTransport * tr = &hidTransports[HID_TRANSPORT_USB];
 
-  if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-    mouseBTPress(button);
+  switch (ev->type) {
+    case HID_EVENT_MOUSE_PRESS:
+    case HID_EVENT_MOUSE_RELEASE:
+    case HID_EVENT_MOUSE_TOGGLE:
+      if (tr->mouseX || tr->mouseY || tr->mouseWheel) {   // keep order of movements and button changes
+        flushUSBMouse();
+        return (0);
+      }
+      if ((ev->type == HID_EVENT_MOUSE_PRESS) ||
+          ((ev->type == HID_EVENT_MOUSE_TOGGLE) && (!Mouse.isPressed(ev->param))))
+        Mouse.press(ev->param);
+      else Mouse.release(ev->param);
+      break;
+    case HID_EVENT_KEY_PRESS: Keyboard.press(ev->value); hidStatistics.keyboardReports++; break;
+    case HID_EVENT_KEY_RELEASE: Keyboard.release(ev->value); hidStatistics.keyboardReports++; break;
+    case HID_EVENT_KEY_RELEASEALL: Keyboard.releaseAll(); hidStatistics.keyboardReports++; break;
+    case HID_EVENT_JOYSTICK_BUTTON:   // joystick changes are sent with the next joystick report
+      Joystick.button(ev->param, ev->value);
+      joystickChanged = 1;
+      break;
+    case HID_EVENT_JOYSTICK_HAT:
+      Joystick.hat(ev->value);
+      joystickChanged = 1;
+      break;
+    case HID_EVENT_RELEASEALL:
+      Keyboard.releaseAll(); hidStatistics.keyboardReports++;
+      Mouse.release(MOUSE_LEFT | MOUSE_RIGHT | MOUSE_MIDDLE);
+      for (uint8_t nr = 1; nr <= 32; nr++) Joystick.button(nr, 0);
+      Joystick.hat(-1);
+      joystickChanged = 1;
+      break;
+  }
+  return (1);
 }
 
-void mouseToggle(uint8_t button)
+/**
+   @name performBTEvent
+   @brief passes a queued event to the BT module
+   @return 0 if the BT keyboard queue is full (event must be performed later), 1 otherwise
+*/
+static uint8_t performBTEvent(struct HIDEvent * ev)
+{
+  struct HIDTransport * tr = &hidTransports[HID_TRANSPORT_BT];
+
+  switch (ev->type) {
+    case HID_EVENT_MOUSE_PRESS:
+    case HID_EVENT_MOUSE_RELEASE:
+    case HID_EVENT_MOUSE_TOGGLE:
+      // pass the pending movement first, the button report contains it (keeps order of movements and button changes)
+      if (tr->mouseX || tr->mouseY || tr->mouseWheel) {
+        mouseBT(tr->mouseX, tr->mouseY, 0);
+        tr->mouseX = tr->mouseY = 0;
+        while (tr->mouseWheel) {   // scroll steps are passed in the range of the report
+          int8_t wheel = constrain(tr->mouseWheel, -127, 127);
+          mouseBT(0, 0, (uint8_t)wheel);
+          tr->mouseWheel -= wheel;
+        }
+      }
+      if ((ev->type == HID_EVENT_MOUSE_PRESS) ||
+          ((ev->type == HID_EVENT_MOUSE_TOGGLE) && (!isMouseBTPressed(ev->param))))
+        mouseBTPress(ev->param);
+      else mouseBTRelease(ev->param);
+      break;
+    case HID_EVENT_KEY_PRESS:
+    case HID_EVENT_KEY_RELEASE:
+    case HID_EVENT_KEY_RELEASEALL:
+      if (!getBTKeyboardQueueFree()) return (0);
+      if (ev->type == HID_EVENT_KEY_PRESS) keyboardBTPress(ev->value);
+      else if (ev->type == HID_EVENT_KEY_RELEASE) keyboardBTRelease(ev->value);
+      else keyboardBTReleaseAll();
+      break;
+    case HID_EVENT_JOYSTICK_BUTTON: joystickBTButton(ev->param, ev->value); break;
+    case HID_EVENT_JOYSTICK_HAT: joystickBTHat(ev->value); break;
+    case HID_EVENT_RELEASEALL:
+      if (!getBTKeyboardQueueFree()) return (0);
+      keyboardBTReleaseAll();
+      mouseBTRelease(MOUSE_LEFT | MOUSE_RIGHT | MOUSE_MIDDLE);
+      for (uint8_t nr = 1; nr <= 32; nr++) joystickBTButton(nr, 0);
+      joystickBTHat(-1);
+      break;
+  }
+  return (1);
+}
+
+/**
+   @name serviceTransportQueue
+   @brief performs queued events of a transport as far as the transport is ready
+*/
+static void serviceTransportQueue(uint8_t t)
 {
-  if (slotSettings.bt & 1) {
-    if (Mouse.isPressed(button))
-      Mouse.release(button); else Mouse.press(button);
+  struct HIDTransport * tr = &hidTransports[t];
+
+  while (tr->queueCount) {
+    struct HIDEvent * ev = &tr->queue[tr->queueHead];
+    if (t == HID_TRANSPORT_USB) {
+      if (!tud_hid_ready()) return;
+      if (!performUSBEvent(ev)) continue;
+    }
+    else if (!performBTEvent(ev)) return;
+    recordHIDLatency(t, ev->timestamp);
+    tr->queueHead = (tr->queueHead + 1) % HID_EVENT_QUEUE_SIZE;
+    tr->queueCount--;
   }
+}
+
+void serviceHIDTransports()
+{
+  hidRouting = 0;
+  if (slotSettings.bt & 1) hidRouting |= (1 << HID_TRANSPORT_USB);
+  if ((slotSettings.bt & 2) && isBluetoothAvailable()) hidRouting |= (1 << HID_TRANSPORT_BT);
 
-  if ((slotSettings.bt & 2) && (isBluetoothAvailable())) {
-    if (isMouseBTPressed(button))
-      mouseBTRelease(button); else mouseBTPress(button);
+  if (!tud_mounted()) {   // no USB host: discard pending events and movement
+    struct HIDTransport * tr = &hidTransports[HID_TRANSPORT_USB];
+    hidTransportStatistics[HID_TRANSPORT_USB].dropped += tr->queueCount;
+    tr->queueCount = 0;
+    tr->mouseX = tr->mouseY = tr->mouseWheel = 0;
+    usbFlushDeferred = 0;
+  }
+  else {
+    serviceTransportQueue(HID_TRANSPORT_USB);
+    if (usbFlushDeferred) {   // reports which could not be sent in the last flushHIDReports
+      usbFlushDeferred = 0;
+      flushUSBMouse();
+      flushUSBJoystick();
+    }
   }
+  serviceTransportQueue(HID_TRANSPORT_BT);
+}
+
+uint8_t getHIDQueueFree(uint8_t t)
+{
+  return (HID_EVENT_QUEUE_SIZE - hidTransports[t].queueCount);
 }
 
+/**
+   @name isTransportActive
+   @brief checks if a transport is selected for HID actions (and the USB host is present)
+*/
+static uint8_t isTransportActive(uint8_t t)
+{
+  if (!(hidRouting & (1 << t))) return (0);
+  if ((t == HID_TRANSPORT_USB) && (!tud_mounted())) return (0);
+  return (1);
+}
 
-void mouseScroll(int8_t steps)
+/**
+   @name isPressEvent
+   @brief checks if an event can be dropped without leaving a key or button pressed
+*/
+static uint8_t isPressEvent(struct HIDEvent * ev)
+{
+  switch (ev->type) {
+    case HID_EVENT_MOUSE_PRESS:
+    case HID_EVENT_KEY_PRESS: return (1);
+    case HID_EVENT_JOYSTICK_BUTTON: return (ev->value != 0);
+  }
+  return (0);
+}
+
+/**
+   @name makeRoomForRelease
+   @brief frees a queue entry for a release event: the oldest queued press is dropped (its release, if queued,
+          is harmless), if the queue holds no press the queued events are replaced by one HID_EVENT_RELEASEALL
+*/
+static void makeRoomForRelease(struct HIDTransport * tr)
+{
+  for (uint8_t i = 0; i < tr->queueCount; i++) {
+    if (!isPressEvent(&tr->queue[(tr->queueHead + i) % HID_EVENT_QUEUE_SIZE])) continue;
+    for (; i + 1 < tr->queueCount; i++)   // close the gap
+      tr->queue[(tr->queueHead + i) % HID_EVENT_QUEUE_SIZE] = tr->queue[(tr->queueHead + i + 1) % HID_EVENT_QUEUE_SIZE];
+    tr->queueCount--;
+    return;
+  }
+  tr->queue[tr->queueHead].type = HID_EVENT_RELEASEALL;
+  tr->queueCount = 1;
+}
+
+/**
+   @name queueHIDEvent
+   @brief passes a discrete HID event to the queues of the selected transports (fan-out).
+          If the queue of a transport is full, a new press is dropped for this transport, a release
+          replaces a queued press (see makeRoomForRelease), so no key or button stays pressed.
+*/
+static void queueHIDEvent(uint8_t type, uint8_t param, int16_t value)
+{
+  for (uint8_t t = 0; t < HID_TRANSPORTS; t++) {
+    if (!isTransportActive(t)) continue;
+    struct HIDTransport * tr = &hidTransports[t];
+
+    if (tr->queueCount == HID_EVENT_QUEUE_SIZE) {
+      serviceTransportQueue(t);
+      if (tr->queueCount == HID_EVENT_QUEUE_SIZE) {
+        if (t == HID_TRANSPORT_USB) hidStatistics.keyboardQueueFull++;
+        hidTransportStatistics[t].dropped++;
+        struct HIDEvent event = {type, param, value, 0};
+        if (isPressEvent(&event)) continue;
+        makeRoomForRelease(tr);
+      }
+    }
+    struct HIDEvent * ev = &tr->queue[(tr->queueHead + tr->queueCount) % HID_EVENT_QUEUE_SIZE];
+    ev->type = type;
+    ev->param = param;
+    ev->value = value;
+    ev->timestamp = micros();
+    tr->queueCount++;
+    serviceTransportQueue(t);
+  }
+}
+
+void initHID()
+{
+  Joystick.useManualSend(true);  // joystick reports are sent manually (flushUSBJoystick)
+  Joystick.use16bit();           // axis values are stored as 16 bit values (see joystickState)
+}
+
+void flushHIDReports()
 {
-  if (slotSettings.bt & 1)
-    Mouse.move(0,0,steps);
+  flushUSBMouse();
+  flushUSBJoystick();
 
-  if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-    mouseBT(0, 0, steps);
+  // BT: pass the merged movement and joystick axes to the BT report scheduler
+  struct HIDTransport * tr = &hidTransports[HID_TRANSPORT_BT];
+  if (tr->mouseX || tr->mouseY || tr->mouseWheel) {
+    int8_t wheel = constrain(tr->mouseWheel, -127, 127);
+    mouseBT(tr->mouseX, tr->mouseY, (uint8_t)wheel);
+    tr->mouseX = tr->mouseY = 0;
+    tr->mouseWheel -= wheel;
+    recordHIDLatency(HID_TRANSPORT_BT, tr->mouseSince);
+    if (tr->mouseUpdates > 1) hidTransportStatistics[HID_TRANSPORT_BT].merged += tr->mouseUpdates - 1;
+    tr->mouseUpdates = 0;
+    tr->mouseSince = micros();
+  }
+  if (tr->axesChanged) {
+    for (uint8_t select = 0; select < 3; select++) {
+      if (!(tr->axesChanged & (3 << (select * 2)))) continue;
+      joystickBTAxis16(joystickState.axis[select * 2], joystickState.axis[select * 2 + 1], select);
+    }
+    recordHIDLatency(HID_TRANSPORT_BT, tr->joystickSince);
+    if (tr->joystickUpdates > 1) hidTransportStatistics[HID_TRANSPORT_BT].merged += tr->joystickUpdates - 1;
+    tr->axesChanged = 0;
+  }
+  tr->joystickUpdates = 0;
+}
+
+void mouseRelease(uint8_t button)
+{
+  queueHIDEvent(HID_EVENT_MOUSE_RELEASE, button, 0);
+}
+
+void mousePress(uint8_t button)
+{
+  queueHIDEvent(HID_EVENT_MOUSE_PRESS, button, 0);
+}
+
+void mouseToggle(uint8_t button)
+{
+  queueHIDEvent(HID_EVENT_MOUSE_TOGGLE, button, 0);
+}
+
+/**
+   @name addMouseMovement
+   @brief merges movement into the pending movement of the selected transports
+*/
+static void addMouseMovement(int x, int y, int wheel)
+{
+  for (uint8_t t = 0; t < HID_TRANSPORTS; t++) {
+    if (!(hidRouting & (1 << t))) continue;
+    struct HIDTransport * tr = &hidTransports[t];
+    if (!tr->mouseUpdates) tr->mouseSince = micros();
+    tr->mouseX += x;
+    tr->mouseY += y;
+    tr->mouseWheel += wheel;
+    tr->mouseUpdates++;
+  }
+}
+
+void mouseScroll(int8_t steps)
+{
+  addMouseMovement(0, 0, steps);
 }
 
 void mouseMove(int x, int y)
@@ -66,119 +461,229 @@ void mouseMove(int x, int y)
     dragRecordingX+=x;
     dragRecordingY+=y;
   }
-  while (x < -128) {
-    if (slotSettings.bt & 1)
-      Mouse.move(-128, 0, 0);
-    if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-      mouseBT(-128, 0, 0);
-    x += 128;
-  }
-  while (x > 127) {
-    if (slotSettings.bt & 1)
-      Mouse.move(127, 0, 0);
-    if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-      mouseBT(127, 0, 0);
-    x -= 127;
-  }
+  addMouseMovement(x, y, 0);
+}
+
+/**
+   typing buffer for keyboardPrint: text is typed asynchronously by updateKeyboardTyping().
+   Key actions (keyboardPress / Release / ReleaseAll) are stored in the same buffer (action code
+   TYPING_ACTION_* followed by the key), so they are performed in order with the typed text.
+*/
+uint8_t typingBuffer[TYPING_BUFFER_SIZE];
+uint16_t typingPos = 0, typingLen = 0;
+uint8_t typingReleaseAll = 0;   // a release did not fit into the typing buffer: release all keys after the pending text
+
+/**
+   @name getTypingKey
+   @brief looks up a character in the current keyboard layout
+   @param c the character
+   @param key pointer where the key (without modifier) is stored
+   @return modifier class of the character (0: none, 1: shift, 2: AltGr), TYPING_SINGLE if the character can't be batched
+*/
+static uint8_t getTypingKey(uint8_t c, uint8_t * key)
+{
+  const uint8_t * layout = getKeyboardLayout();
+  if ((c >= 128) || (!layout)) return (TYPING_SINGLE);
+
+  uint8_t code = pgm_read_byte(layout + c);
+  if (!code) return (TYPING_SINGLE);
+  if ((code & ALT_GR) == ALT_GR) { *key = code & 0x3F; return (2); }
+  if (code & SHIFT) { *key = code & 0x7F; return (1); }
+  *key = code;
+  return (0);
+}
+
+void updateKeyboardTyping()
+{
+  while (typingPos < typingLen) {
+    // only continue if the queues of the selected transports can take a complete batch
+    for (uint8_t t = 0; t < HID_TRANSPORTS; t++) {
+      if (isTransportActive(t) && (getHIDQueueFree(t) < 2 * TYPING_BATCH_SIZE)) return;
+    }
+
+    // key action: action code and key
+    uint8_t action = typingBuffer[typingPos];
+    if ((action >= TYPING_ACTION_PRESS) && (action <= TYPING_ACTION_RELEASEALL)) {
+      queueHIDEvent(HID_EVENT_KEY_PRESS + action - TYPING_ACTION_PRESS, 0, typingBuffer[typingPos + 1]);
+      typingPos += 2;
+      continue;
+    }
+
+    // collect consecutive characters with the same modifiers and different keys
+    uint8_t keys[TYPING_BATCH_SIZE], count = 1;
+    uint8_t modifier = getTypingKey(typingBuffer[typingPos], &keys[0]);
+    if (modifier != TYPING_SINGLE) {
+      while ((count < TYPING_BATCH_SIZE) && (typingPos + count < typingLen)) {
+        uint8_t key, i;
+        if (getTypingKey(typingBuffer[typingPos + count], &key) != modifier) break;
+        for (i = 0; (i < count) && (keys[i] != key); i++);
+        if (i < count) break;   // same key again: must be released first
+        keys[count++] = key;
+      }
+    }
 
-  while (y < -128) {
-    if (slotSettings.bt & 1)
-      Mouse.move(0, -128, 0);
-    if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-      mouseBT(0, -128, 0);
-    y += 128;
+    // press the keys one after another (keeps the typing order), then release them
+    for (uint8_t i = 0; i < count; i++) {
+      queueHIDEvent(HID_EVENT_KEY_PRESS, 0, typingBuffer[typingPos + i]);
+    }
+    if ((count > 1) && (!keysPressed())) {   // one release report, if no other keys are held
+      queueHIDEvent(HID_EVENT_KEY_RELEASEALL, 0, 0);
+    }
+    else {
+      for (uint8_t i = 0; i < count; i++) {
+        queueHIDEvent(HID_EVENT_KEY_RELEASE, 0, typingBuffer[typingPos + i]);
+      }
+    }
+    typingPos += count;
   }
-  while (y > 127) {
-    if (slotSettings.bt & 1)
-      Mouse.move(0, 127, 0);
-    if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-      mouseBT(0, 127, 0);
-    y -= 127;
+  typingPos = typingLen = 0;
+  if (typingReleaseAll) {   // releases are never dropped by the transport queues
+    queueHIDEvent(HID_EVENT_KEY_RELEASEALL, 0, 0);
+    typingReleaseAll = 0;
   }
+}
 
-  if (slotSettings.bt & 1)
-    Mouse.move(x, y, 0);
-  if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-    mouseBT(x, y, 0);
+/**
+   @name reserveTyping
+   @brief makes room for len bytes in the typing buffer (moves the untyped part to the start)
+   @return 1 if there is room, 0 if the typing buffer is full
+*/
+static uint8_t reserveTyping(uint16_t len)
+{
+  if (typingLen + len > TYPING_BUFFER_SIZE) {
+    memmove(typingBuffer, typingBuffer + typingPos, typingLen - typingPos);
+    typingLen -= typingPos;
+    typingPos = 0;
+  }
+  return (typingLen + len <= TYPING_BUFFER_SIZE);
 }
 
-void keyboardPrint(char * keystring)
+/**
+   @name queueKeyAction
+   @brief appends a key action to the typing buffer (performed after the pending text),
+          a press is rejected if the typing buffer is full up to the release reserve
+*/
+static void queueKeyAction(uint8_t action, int key)
 {
-  if (slotSettings.bt & 1) {
-    //Keyboard.print(keystring);  // improved for ISO 8859 compatibility (but: slower ..)
-    for (unsigned int i = 0; i < strlen(keystring); i++)
-    {
-      Keyboard.write(keystring[i]);
+  if (action != TYPING_ACTION_PRESS) {
+    if (!reserveTyping(2)) {   // not even the reserve is left: release all keys instead
+      typingReleaseAll = 1;
+      return;
     }
   }
+  else if ((!reserveTyping(2 + TYPING_RELEASE_RESERVE)) || typingReleaseAll) {
+    hidStatistics.typingDropped++;
+    SerialOut.println("E: keyboard buffer full");
+    return;
+  }
+  typingBuffer[typingLen++] = action;
+  typingBuffer[typingLen++] = key;
+  updateKeyboardTyping();
+}
+
+void keyboardPrint(char * keystring)
+{
+  uint16_t dropped = 0;
 
-  if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-    keyboardBTPrint(keystring);  // TODO: check ISO8859-compatibility
+  reserveTyping(strlen(keystring) + TYPING_RELEASE_RESERVE);
+  for (char * c = keystring; *c; c++) {
+    // control codes of key actions can't be typed: skip them
+    if ((*c >= TYPING_ACTION_PRESS) && (*c <= TYPING_ACTION_RELEASEALL)) continue;
+    if (typingLen < TYPING_BUFFER_SIZE - TYPING_RELEASE_RESERVE) typingBuffer[typingLen++] = *c;
+    else dropped++;   // text does not fit: type as much as possible
+  }
+  if (dropped) {
+    hidStatistics.typingDropped += dropped;
+    SerialOut.print("E: keyboard buffer full, dropped characters: ");
+    SerialOut.println(dropped);
+  }
+  updateKeyboardTyping();
 }
 
 void keyboardPress(int key)
 {
-  if (slotSettings.bt & 1)
-    Keyboard.press(key);
-  if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-    keyboardBTPress(key);
+  queueKeyAction(TYPING_ACTION_PRESS, key);
 }
 
 void keyboardRelease(int key)
 {
-  if (slotSettings.bt & 1)
-    Keyboard.release(key);
-  if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-    keyboardBTRelease(key);
+  queueKeyAction(TYPING_ACTION_RELEASE, key);
 }
 
 void keyboardReleaseAll()
 {
-  if (slotSettings.bt & 1)
-    Keyboard.releaseAll();
-  if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-    keyboardBTReleaseAll();
+  queueKeyAction(TYPING_ACTION_RELEASEALL, 0);
 }
 
-void joystickAxis(int axis1, int axis2, uint8_t select)
+/**
+   @name setJoystickAxes
+   @brief sets 2 joystick axes (16 bit values), an axis with the value JOYSTICK_AXIS_UNCHANGED is not updated.
+          Changed axes are marked for the selected transports (sent with the next flushHIDReports).
+*/
+static void setJoystickAxes(int32_t axis1, int32_t axis2, uint8_t select)
 {
-  if (slotSettings.bt & 1)
-  {
-    switch(select)
-    {
-      case 0:
-        Joystick.X(axis1);
-        Joystick.Y(axis2);
-      break;
-      case 1:
-        Joystick.Z(axis1);
-        Joystick.Zrotate(axis2);
-      break;
-      case 2:
-        Joystick.sliderLeft(axis1);
-        Joystick.sliderRight(axis2);
-      break;
-      default: break;
-    }
+  if (select > 2) return;
+
+  uint8_t changed = 0;
+  int32_t val[2] = {axis1, axis2};
+  for (uint8_t i = 0; i < 2; i++) {
+    uint8_t index = select * 2 + i;
+    if ((val[i] == JOYSTICK_AXIS_UNCHANGED) || (joystickState.axis[index] == val[i])) continue;
+    joystickState.axis[index] = val[i];
+    changed |= 1 << index;
   }
-  if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-  {
-    joystickBTAxis(axis1, axis2, select);
+
+  for (uint8_t t = 0; t < HID_TRANSPORTS; t++) {
+    if (!(hidRouting & (1 << t))) continue;
+    struct HIDTransport * tr = &hidTransports[t];
+    if (!tr->joystickUpdates) tr->joystickSince = micros();
+    tr->joystickUpdates++;
+    tr->axesChanged |= changed;
   }
 }
 
+/**
+   @name joystickAxisTo16
+   @brief converts a 10 bit axis value (0-1023, -1: unchanged) to the 16 bit range
+*/
+static int32_t joystickAxisTo16(int val)
+{
+  if (val == -1) return (JOYSTICK_AXIS_UNCHANGED);
+  return (map(constrain(val, 0, 1023), 0, 1023, -32767, 32767));
+}
+
+void joystickAxis(int axis1, int axis2, uint8_t select)
+{
+  setJoystickAxes(joystickAxisTo16(axis1), joystickAxisTo16(axis2), select);
+}
+
+/**
+   @name clampJoystickAxis16
+   @brief limits a 16 bit joystick axis value to -32767..32767, JOYSTICK_AXIS_UNCHANGED is passed as is
+*/
+static int32_t clampJoystickAxis16(int32_t val)
+{
+  if (val == JOYSTICK_AXIS_UNCHANGED) return (val);
+  return (constrain(val, -32767, 32767));
+}
+
+void joystickAxis16(int32_t axis1, int32_t axis2, uint8_t select)
+{
+  setJoystickAxes(clampJoystickAxis16(axis1), clampJoystickAxis16(axis2), select);
+}
+
 void joystickButton(uint8_t nr, int val)
 {
-  if (slotSettings.bt & 1) 
-    Joystick.button(nr,val);
-  if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-    joystickBTButton(nr,val);
+  if ((nr < 1) || (nr > 32)) return;
+  uint32_t mask = 1UL << (nr - 1);
+  if (((joystickState.buttons & mask) != 0) == (val != 0)) return;   // no change
+  joystickState.buttons ^= mask;
+  queueHIDEvent(HID_EVENT_JOYSTICK_BUTTON, nr, val != 0);
 }
 
 void joystickHat(int val)
 {
-  if (slotSettings.bt & 1) 
-    Joystick.hat(val);
-  if ((slotSettings.bt & 2) && (isBluetoothAvailable()))
-    joystickBTHat(val);
+  if (joystickState.hat == val) return;
+  joystickState.hat = val;
+  queueHIDEvent(HID_EVENT_JOYSTICK_HAT, 0, val);
 }
@@ -22,6 +22,40 @@
 #define DRAG_RECORDING_IDLE 0
 #define DRAG_RECORDING_ACTIVE 1
 
+#define HID_TRANSPORT_USB       0
+#define HID_TRANSPORT_BT        1
+#define HID_TRANSPORTS          2
+#define HID_EVENT_QUEUE_SIZE    64    // number of queued button / key events per transport
+#define TYPING_BUFFER_SIZE      512   // buffer for asynchronous typing of keyboardPrint strings
+#define TYPING_RELEASE_RESERVE  32    // bytes of the typing buffer which only key releases can use (no stuck keys)
+#define TYPING_BATCH_SIZE       6     // maximum number of keys pressed together while typing (6KRO report)
+#define TYPING_SINGLE           0xff  // character can't be batched (typed with individual press and release)
+#define TYPING_ACTION_PRESS       0x01  // typing buffer: key action codes (followed by the key)
+#define TYPING_ACTION_RELEASE     0x02
+#define TYPING_ACTION_RELEASEALL  0x03
+
+/**
+   HIDStatistics struct
+   counts sent USB HID reports and reports which were avoided by coalescing (for AT ST)
+*/
+struct HIDStatistics {
+  uint32_t mouseReports, mouseAvoided;
+  uint32_t joystickReports, joystickAvoided;
+  uint32_t keyboardReports, keyboardQueueFull;
+  uint32_t typingDropped;   // characters / key actions rejected because the typing buffer was full
+};
+
+/**
+   HIDTransportStatistics struct
+   counts the reports / events of one transport (USB or BT, for AT ST)
+*/
+struct HIDTransportStatistics {
+  uint32_t sent;      // events and reports passed to the transport
+  uint32_t merged;    // movement / joystick axis updates merged into a following report
+  uint32_t dropped;   // events dropped because the queue of the transport was full (or no USB host)
+  uint32_t latencyMax, latencyTotal;   // time between HID action and passing it to the transport (microseconds)
+};
+
 /**
    extern declaration of static variables
    which shall be accessed from other modules
@@ -29,6 +63,52 @@
 extern uint8_t dragRecordingState;
 extern int16_t dragRecordingX;
 extern int16_t dragRecordingY;
+extern struct HIDStatistics hidStatistics;
+extern struct HIDTransportStatistics hidTransportStatistics[HID_TRANSPORTS];
+
+/*
+   @name initHID
+   @param none
+   @return none
+
+   Prepares the USB HID interfaces (joystick reports are sent manually by flushHIDReports).
+
+   HID actions (mouse, keyboard, joystick) are passed to the transports selected by slotSettings.bt.
+   Each transport has its own event queue and pending movement / joystick state, so a slow
+   transport does not delay the other one.
+*/
+void initHID();
+
+/*
+   @name flushHIDReports
+   @param none
+   @return none
+
+   Sends the collected HID changes of the current update: at most one USB mouse movement report
+   and one USB joystick report; the merged BT movement and joystick axes are passed to the BT
+   report scheduler. Called once per update interval.
+   
+   @note Button and key events are queued and sent by serviceHIDTransports (after pending movements).
+*/
+void flushHIDReports();
+
+/*
+   @name serviceHIDTransports
+   @param none
+   @return none
+
+   Updates the transport selection (slotSettings.bt, BT module available) and performs queued
+   events: USB events while the HID endpoint is ready, BT events while the BT keyboard queue
+   has space. Called frequently from loop().
+*/
+void serviceHIDTransports();
+
+/*
+   @name getHIDQueueFree
+   @param uint8_t t transport (HID_TRANSPORT_USB or HID_TRANSPORT_BT)
+   @return number of free entries in the event queue of the transport
+*/
+uint8_t getHIDQueueFree(uint8_t t);
 
 /*
    @name keyboardPrint
@@ -36,15 +116,31 @@ extern int16_t dragRecordingY;
    @return none
 
    This method prints out an ASCII string (no modifiers available!)
+   The string is typed asynchronously (see updateKeyboardTyping). If the typing buffer is full
+   (up to TYPING_RELEASE_RESERVE), the remaining characters are dropped (reported with an error
+   message and in typingDropped).
 */
 void keyboardPrint(char * keyString);
 
+/*
+   @name updateKeyboardTyping
+   @param none
+   @return none
+
+   Passes the text of keyboardPrint to the transport queues, as soon as there is space.
+   Consecutive characters with the same modifiers and different keys are typed as a batch:
+   pressed one after another and released with one report. Called frequently from loop().
+*/
+void updateKeyboardTyping();
+
 /*
    @name keyboardPress
    @param int key keycode to be typed by keyboard
    @return none
 
    This method presses a key of given keycode (modifiers available!)
+   The action is queued behind pending text of keyboardPrint (rejected if the typing buffer is full
+   up to TYPING_RELEASE_RESERVE).
 */
 void keyboardPress(int key);
 
@@ -54,6 +150,8 @@ void keyboardPress(int key);
    @return none
 
    This method releases a key of given keycode (modifiers available!)
+   The action is queued behind pending text of keyboardPrint. It is never rejected: if even the
+   reserve of the typing buffer is full, all keys are released after the pending text.
 */
 void keyboardRelease(int key);
 
@@ -63,6 +161,7 @@ void keyboardRelease(int key);
    @return none
 
    This method releases all currently pressed keys
+   The action is queued behind pending text of keyboardPrint (never rejected, see keyboardRelease).
 */
 void keyboardReleaseAll();
 
@@ -130,6 +229,20 @@ void mouseMove(int x, int y);
 void joystickAxis(int axis1, int axis2, uint8_t select);
 
 
+/*
+   @name joystickAxis16
+   @param int32_t axis1   new value for axis 1 (either X,Z or sliderLeft; set by param select)
+   @param int32_t axis2   new value for axis 2 (either Y,Zrotate or sliderRight; set by param select)
+   @param uint8_t select  define axis for values (0: X/Y; 1: Z/Zrotate; 2: sliderLeft/sliderRight)
+
+   Updates 2 joystick axis with new 16 bit values.
+   
+   @note The range for axis1 & axis2 is -32767 to 32767 (USB), BT reports are reduced to 8 bit.
+   @note If an axis is set to JOYSTICK_AXIS_UNCHANGED, it will not be updated.
+*/
+void joystickAxis16(int32_t axis1, int32_t axis2, uint8_t select);
+
+
 /*
    @name joystickButton
    @param uint8_t nr    button number (1-32)
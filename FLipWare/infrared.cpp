@@ -17,6 +17,7 @@
 #include "FlipWare.h"
 #include "infrared.h"
 #include "tone.h"
+#include "reporting.h"
 /**
    static variables for infrared code generation and timekeeping
  * */
@@ -112,7 +113,7 @@ void record_IR_command(char * name)
     //cancel recording if takes longer than the user timeout
     if (duration >= IR_USER_TIMEOUT_MS)
     {
-      Serial.println("IR_TIMEOUT: User timeout");
+      SerialOut.println("IR_TIMEOUT: User timeout");
       return;
     }
   }
@@ -137,29 +138,30 @@ void record_IR_command(char * name)
   }
 
   if (edges == IR_EDGE_REC_MAX)
-    Serial.println("IR-Code sequence full.");
-  else Serial.println("IR-Code timeout reached.");
+    SerialOut.println("IR-Code sequence full.");
+  else SerialOut.println("IR-Code timeout reached.");
 
   //play a feedback tone
   makeTone(TONE_IR_REC, 0);
 
   //full edge feedback, if full debug is enabled
 #ifdef DEBUG_OUTPUT_IR
-  Serial.println("START IR ----------");
+  SerialOut.println("START IR ----------");
   for (uint8_t i = 0; i < edges; i++)
-    Serial.println(timings[i]);
-  Serial.println("END ----------");
+    SerialOut.println(timings[i]);
+  SerialOut.println("END ----------");
 #endif
 
   //return the recorded command name and the edge count
-  Serial.print("IR: recorded command ");
-  Serial.print(name);
-  Serial.print(" with ");
-  Serial.print(edges);
-  Serial.println(" edge times.");
+  SerialOut.print("IR: recorded command ");
+  SerialOut.print(name);
+  SerialOut.print(" with ");
+  SerialOut.print(edges);
+  SerialOut.println(" edge times.");
 
   //save the recorded command to the EEPROM storage
   saveIRToEEPROM(name, (uint16_t *)timings, (uint16_t)edges);
+  reportEvent(EVENT_IR, edges, name);
 }
 
 /**
@@ -204,8 +206,8 @@ uint8_t delete_IR_command(char * name)
   #endif
   /* Disabled, IRQ context here!
    * #ifdef DEBUG_OUTPUT_IR
-    Serial.print("id:");
-    Serial.println(id);
+    SerialOut.print("id:");
+    SerialOut.println(id);
   #endif*/
   if (act_edge > edges) {          // one code repetition finished
     analogWrite(IR_LED_PIN, 0);
@@ -297,24 +299,24 @@ void start_IR_command_playback(char * name)
   if (edges == 0)
   {
 #ifdef DEBUG_OUTPUT_IR
-    Serial.print("No IR command found: ");
-    Serial.println(name);
+    SerialOut.print("No IR command found: ");
+    SerialOut.println(name);
 #endif
     return;
   }
 
   //full edge feedback, if full debug is enabled
 #ifdef DEBUG_OUTPUT_IR
-  Serial.println("START IR ----------");
+  SerialOut.println("START IR ----------");
   for (uint16_t i = 0; i < edges; i++)
   {
-    Serial.println(timings[i]);
+    SerialOut.println(timings[i]);
   }
-  Serial.println("END ----------");
-  Serial.print("act_edge: ");
-  Serial.print(act_edge);
-  Serial.print(", edges: ");
-  Serial.println(edges);
+  SerialOut.println("END ----------");
+  SerialOut.print("act_edge: ");
+  SerialOut.print(act_edge);
+  SerialOut.print(", edges: ");
+  SerialOut.println(edges);
 #endif
 
   makeTone(TONE_IR, 0);
@@ -328,7 +330,7 @@ void start_IR_command_playback(char * name)
     #else
       ir_alarm_id = add_alarm_in_us(25, generate_next_IR_phase, nullptr, true);
     #endif
-    if(ir_alarm_id == -1) Serial.println("IR: no alarm available!");
+    if(ir_alarm_id == -1) SerialOut.println("IR: no alarm available!");
     //busy wait for finished IR
     while(act_edge < edges);
   #else
@@ -21,7 +21,7 @@
 /**
    forward declarations of module-internal functions
 */
-int pressed_keys[KEYPRESS_BUFFERSIZE];
+uint32_t pressed_keys[PRESSED_KEYS_WORDS];
 uint8_t in_keybuffer(int key);
 void remove_from_keybuffer(int key);
 void add_to_keybuffer(int key);
@@ -36,7 +36,7 @@ const uint8_t *kbdLayoutArray = KeyboardLayout_en_US;
 */
 void printKeyboardLayout()
 {
-	Serial.println(kbdLayout);
+	SerialOut.println(kbdLayout);
 }
 
 /**
@@ -63,9 +63,9 @@ int8_t setKeyboardLayout(char *name)
 		Keyboard.begin(newLayout);
     kbdLayoutArray = newLayout;
 		#ifdef DEBUG_OUTPUT_FULL
-			Serial.print("Found new layout pointer for ");
-			Serial.print(name);
-			Serial.println(", setting in Keyboard.begin");
+			SerialOut.print("Found new layout pointer for ");
+			SerialOut.print(name);
+			SerialOut.println(", setting in Keyboard.begin");
 		#endif
     strncpy(kbdLayout,name,5); //save locally
 		return 1;
@@ -94,11 +94,11 @@ void updateKey(int key, uint8_t keyAction)
   switch (keyAction)  {
     case KEY_PRESS:
     #ifdef DEBUG_OUTPUT_KEYS
-      Serial.print("P+");
+      SerialOut.print("P+");
     #endif
     case KEY_HOLD:
       #ifdef DEBUG_OUTPUT_KEYS
-        Serial.println("H");
+        SerialOut.println("H");
       #endif
       add_to_keybuffer(key);
       keyboardPress(key);       // press/hold keys individually
@@ -106,7 +106,7 @@ void updateKey(int key, uint8_t keyAction)
 
     case KEY_RELEASE:
       #ifdef DEBUG_OUTPUT_KEYS
-        Serial.println("R");
+        SerialOut.println("R");
       #endif
       remove_from_keybuffer(key);
       keyboardRelease(key);       // release keys individually
@@ -114,25 +114,24 @@ void updateKey(int key, uint8_t keyAction)
 
     case KEY_TOGGLE:
       #ifdef DEBUG_OUTPUT_KEYS
-        Serial.print("T-");
+        SerialOut.print("T-");
       #endif
       if (in_keybuffer(key))  {
         #ifdef DEBUG_OUTPUT_KEYS
-          Serial.println("R");
+          SerialOut.println("R");
         #endif
         remove_from_keybuffer(key);
         keyboardRelease(key);
       } else {
         #ifdef DEBUG_OUTPUT_KEYS
-          Serial.println("P");
+          SerialOut.println("P");
         #endif
         add_to_keybuffer (key);
         keyboardPress(key);
       }
       break;
   }
-  //need to delay to avoid missing keyboard actions
-  delay(10);
+  // note: keyboard actions are queued and paced by the USB HID endpoint / BT report interval (see hid_hal.cpp)
 }
 
 void pressKeys (char * text)
@@ -159,7 +158,7 @@ void toggleKeys (char * text)
 void release_all_keys()
 {
   keyboardReleaseAll();
-  for (int i = 0; i < KEYPRESS_BUFFERSIZE; i++)
+  for (int i = 0; i < PRESSED_KEYS_WORDS; i++)
     pressed_keys[i] = 0;
 }
 
@@ -176,57 +175,45 @@ void release_all()  // releases all previously pressed keys and stop mouse actio
 
 /**
    @name add_to_keybuffer
-   @brief adds a keycode to buffer of pressed keys
+   @brief adds a keycode to the bitset of pressed keys
    @param key the keycode
    @return none
 */
 void add_to_keybuffer(int key)
 {
-  for (int i = 0; i < KEYPRESS_BUFFERSIZE; i++)
-  {
-    if (pressed_keys[i] == 0)
-      pressed_keys[i] = key;
-    if (pressed_keys[i] == key) i = KEYPRESS_BUFFERSIZE;
-  }
+  if ((key >= 0) && (key < PRESSED_KEYS_WORDS * 32))
+    pressed_keys[key >> 5] |= (1UL << (key & 31));
 }
 
 /**
    @name remove_from_keybuffer
-   @brief removes a keycode from buffer of pressed keys
+   @brief removes a keycode from the bitset of pressed keys
    @param key the keycode
    @return none
 */
 void remove_from_keybuffer(int key)
 {
-  for (int i = 0; i < KEYPRESS_BUFFERSIZE; i++)
-  {
-    if (pressed_keys[i] == key)
-    {
-      while (i < KEYPRESS_BUFFERSIZE - 1)
-      {
-        pressed_keys[i] = pressed_keys[i + 1];
-        i++;
-      }
-      pressed_keys[KEYPRESS_BUFFERSIZE - 1] = 0;
-      i = KEYPRESS_BUFFERSIZE;
-    }
-  }
+  if ((key >= 0) && (key < PRESSED_KEYS_WORDS * 32))
+    pressed_keys[key >> 5] &= ~(1UL << (key & 31));
+}
+
+uint8_t keysPressed()
+{
+  for (int i = 0; i < PRESSED_KEYS_WORDS; i++)
+    if (pressed_keys[i]) return (1);
+  return (0);
 }
 
 /**
    @name in_keybuffer
-   @brief returns true if a given keycode is in the buffer of pressed keys
+   @brief returns true if a given keycode is in the bitset of pressed keys
    @param key the keycode
    @return true if key is actually pressed, otherwise false
 */
 uint8_t in_keybuffer(int key)
 {
-  for (int i = 0; i < KEYPRESS_BUFFERSIZE; i++)
-  {
-    if (pressed_keys[i] == key)
-      return (1);
-  }
-  return (0);
+  if ((key < 0) || (key >= PRESSED_KEYS_WORDS * 32)) return (0);
+  return ((pressed_keys[key >> 5] >> (key & 31)) & 1);
 }
 
 /**
@@ -358,12 +345,12 @@ void performKeyActions(char* text,  uint8_t keyAction)
       
       for (unsigned int i = 0; i < KEYMAP1_ELEMENTS; i++) {
         #ifdef DEBUG_OUTPUT_KEYS
-          Serial.print("scanning for ");  Serial.println(keymap1[i].token);
+          SerialOut.print("scanning for ");  SerialOut.println(keymap1[i].token);
         #endif
         
         if (!strcmp(acttoken, keymap1[i].token)) {
           #ifdef DEBUG_OUTPUT_KEYS
-            Serial.print("found @"); Serial.print(i); Serial.print(", keycode: "); Serial.println(keymap1[i].key);
+            SerialOut.print("found @"); SerialOut.print(i); SerialOut.print(", keycode: "); SerialOut.println(keymap1[i].key);
           #endif
           
           updateKey(keymap1[i].key, keyAction);
@@ -376,7 +363,7 @@ void performKeyActions(char* text,  uint8_t keyAction)
       if(!found && (acttoken[0] >= '0' && acttoken[0] <= '9'))
       {
         #ifdef DEBUG_OUTPUT_KEYS
-          Serial.print("found num key: "); Serial.println(acttoken[0]);
+          SerialOut.print("found num key: "); SerialOut.println(acttoken[0]);
         #endif
         
         updateKey(acttoken[0], keyAction);
@@ -386,7 +373,7 @@ void performKeyActions(char* text,  uint8_t keyAction)
       if(!found && (acttoken[0] >= 'A' && acttoken[0] <= 'Z'))
       {
         #ifdef DEBUG_OUTPUT_KEYS
-          Serial.print("found ascii keys: "); Serial.println(toLowerCase(acttoken[0]));
+          SerialOut.print("found ascii keys: "); SerialOut.println(toLowerCase(acttoken[0]));
         #endif
         
         updateKey(toLowerCase(acttoken[0]), keyAction);
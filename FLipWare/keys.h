@@ -21,8 +21,8 @@
 #define KEY_RELEASE  2
 #define KEY_TOGGLE   3
 
-// size of the buffer for currently pressed keys
-#define KEYPRESS_BUFFERSIZE 8
+// number of 32 bit words for the bitset of currently pressed keys (one bit per keycode 0-255)
+#define PRESSED_KEYS_WORDS 8
 
 /**
    @name printKeyboardLayout
@@ -86,6 +86,13 @@ void releaseKeys(char* text);
 */
 void release_all_keys();
 
+/**
+   @name keysPressed
+   @brief checks if any keys are currently pressed / held
+   @return true if at least one key is pressed
+*/
+uint8_t keysPressed();
+
 /**
    @name release_all
    @brief releases all previously pressed keys and stops ongoing mouse actions
@@ -27,12 +27,17 @@ uint8_t strongSipPuffState = STRONG_MODE_IDLE;
 uint8_t mouseMoveCount = 0;
 unsigned long currentTime;
 unsigned long previousTime = 0;
+uint16_t joystickCurveX[JOYSTICK_LUT_SEGMENTS + 1];  // response curve lookup table for joystick x axis
+uint16_t joystickCurveY[JOYSTICK_LUT_SEGMENTS + 1];  // response curve lookup table for joystick y axis
 
 
 /**
    forward declarations of module-internal functions
 */
 void handleMovement(); 
+void updatePressureDerivatives();
+uint8_t predictOnset(int dir);
+uint8_t handlePressureLevels();
 
 void handleUserInteraction()
 {
@@ -63,6 +68,24 @@ void handleUserInteraction()
   if (sensorData.pressure > previousPressure) pressureRising = 1; else pressureRising = 0;
   if (sensorData.pressure < previousPressure) pressureFalling = 1; else pressureFalling = 0;
   previousPressure = sensorData.pressure;
+  updatePressureDerivatives();
+
+  // pressure levels replace the sip/puff and strong sip/puff handling
+  if (handlePressureLevels()) {
+    handleMovement();
+    return;
+  }
+
+  // the same for continuous pressure control: the pressure is an analog value, no sip/puff thresholds
+  if (slotSettings.pa != PRESSURECONTROL_OFF) {
+    if (puffState == SIP_PUFF_STATE_PRESSED) handleRelease(PUFF_BUTTON);
+    if (sipState == SIP_PUFF_STATE_PRESSED) handleRelease(SIP_BUTTON);
+    puffState = SIP_PUFF_STATE_IDLE; sipState = SIP_PUFF_STATE_IDLE;
+    strongSipPuffState = STRONG_MODE_IDLE;
+    waitStable = 0;
+    handleMovement();
+    return;
+  }
 
   if (slotSettings.stickMode == STICKMODE_ALTERNATIVE)
     strongDirThreshold = 0;
@@ -198,7 +221,13 @@ void handleUserInteraction()
         break;
 
       case SIP_PUFF_STATE_STARTED:
-        if (!pressureRising)
+        if ((slotSettings.po == ONSET_PREDICTIVE) && predictOnset(1))
+        {
+          puffCount = MIN_HOLD_TIME;
+          handlePress(PUFF_BUTTON);
+          puffState = SIP_PUFF_STATE_PRESSED;
+        }
+        else if (!pressureRising)
         {
           if (puffCount++ > SIP_PUFF_SETTLE_TIME)
           {
@@ -211,7 +240,7 @@ void handleUserInteraction()
 
       case SIP_PUFF_STATE_PRESSED:
         if (puffCount) puffCount--;
-        if ((sensorData.pressure < slotSettings.tp) && (!puffCount)) {
+        if ((sensorData.pressure < slotSettings.tp - (slotSettings.po ? ONSET_RELEASE_HYSTERESIS : 0)) && (!puffCount)) {
           handleRelease(PUFF_BUTTON);
           puffState = 0;
         }
@@ -227,7 +256,13 @@ void handleUserInteraction()
         break;
 
       case SIP_PUFF_STATE_STARTED:
-        if (!pressureFalling)
+        if ((slotSettings.po == ONSET_PREDICTIVE) && predictOnset(-1))
+        {
+          sipCount = MIN_HOLD_TIME;
+          handlePress(SIP_BUTTON);
+          sipState = SIP_PUFF_STATE_PRESSED;
+        }
+        else if (!pressureFalling)
         {
           if (sipCount++ > SIP_PUFF_SETTLE_TIME)
           {
@@ -240,7 +275,7 @@ void handleUserInteraction()
 
       case SIP_PUFF_STATE_PRESSED:
         if (sipCount) sipCount--;
-        if ((sensorData.pressure > slotSettings.ts) && (!sipCount)) {
+        if ((sensorData.pressure > slotSettings.ts + (slotSettings.po ? ONSET_RELEASE_HYSTERESIS : 0)) && (!sipCount)) {
           handleRelease(SIP_BUTTON);
           sipState = 0;
         }
@@ -251,6 +286,112 @@ void handleUserInteraction()
   }
 }
 
+/**
+   lookup table for pressure levels: for every pressure value, the lower nibble holds the level (1-6) which is entered,
+   the upper nibble holds the highest level which is still held (exit pressure not reached); 0: no level
+*/
+uint8_t pressureLevelTable[1024];
+uint8_t pressureLevelsActive = 0;
+
+/**
+   @name updatePressureLevels
+   @brief precalculates the pressure level lookup table (from the pressure level settings of the current slot)
+   @return none
+*/
+void updatePressureLevels() {
+  pressureLevelsActive = 0;
+  for (int p = 0; p < 1024; p++) {
+    uint8_t enter = 0, hold = 0;
+    for (int l = 0; l < PRESSURE_LEVELS; l++) {
+      uint16_t entry = slotSettings.pz[l][0], exit = slotSettings.pz[l][1];
+      if (!entry) continue;
+      pressureLevelsActive = 1;
+      if (l < PRESSURE_LEVELS / 2) {       // puff levels: pressure above thresholds
+        if (p >= entry) enter = l + 1;
+        if (p >= exit) hold = l + 1;
+      }
+      else {                               // sip levels: pressure below thresholds
+        if (p <= entry) enter = l + 1;
+        if (p <= exit) hold = l + 1;
+      }
+    }
+    pressureLevelTable[p] = enter | (hold << 4);
+  }
+}
+
+/**
+   @name handlePressureLevels
+   @brief presses / releases the pressure level buttons (one table lookup per update, with entry/exit hysteresis)
+          a higher level of the same direction replaces a lower one, falling below the exit pressure returns to
+          the next lower level which is still held
+   @return 1 if pressure levels are active in this slot, 0 otherwise
+*/
+uint8_t handlePressureLevels() {
+  static uint8_t activeLevel = 0;
+
+  if (!pressureLevelsActive) {
+    if (activeLevel) handleRelease(PUFF_LEVEL1_BUTTON + activeLevel - 1);
+    activeLevel = 0;
+    return (0);
+  }
+
+  uint8_t entry = pressureLevelTable[constrain(sensorData.pressure, 0, 1023)];
+  uint8_t enter = entry & 0x0f, hold = entry >> 4;
+  uint8_t level = 0;
+
+  // stay in the active level (or fall back to a lower one of the same direction) while its exit pressure is not reached
+  if (activeLevel && hold && ((hold - 1) / 3 == (activeLevel - 1) / 3))
+    level = hold < activeLevel ? hold : activeLevel;
+  if (enter > level) level = enter;
+
+  if (level != activeLevel) {
+    if (activeLevel) handleRelease(PUFF_LEVEL1_BUTTON + activeLevel - 1);
+    if (level) handlePress(PUFF_LEVEL1_BUTTON + level - 1);
+    activeLevel = level;
+  }
+  return (1);
+}
+
+/**
+   static variables for predictive sip/puff onset detection (ONSET_FRACBITS fixed point)
+*/
+int32_t pressureFiltered = 512 << ONSET_FRACBITS, pressureSlope = 0, pressureCurvature = 0;
+
+/**
+   @name updatePressureDerivatives
+   @brief updates filtered pressure, its slope and curvature (called once per update)
+   @return none
+*/
+void updatePressureDerivatives() {
+  int32_t previousFiltered = pressureFiltered;
+  int32_t previousSlope = pressureSlope;
+
+  pressureFiltered += (((int32_t)sensorData.pressure << ONSET_FRACBITS) - pressureFiltered) / 2;
+  pressureSlope += ((pressureFiltered - previousFiltered) - pressureSlope) / 2;
+  pressureCurvature += ((pressureSlope - previousSlope) - pressureCurvature) / 2;
+}
+
+/**
+   @name predictOnset
+   @brief predicts if a rising sip/puff will settle below the strong sip/puff threshold,
+          so that the sip/puff action can be performed without waiting for settled pressure
+   @param dir 1 for puff, -1 for sip
+   @return 1 if the sip/puff can be performed now, 0 otherwise
+*/
+uint8_t predictOnset(int dir) {
+  int32_t level = dir * (pressureFiltered - (512 << ONSET_FRACBITS));
+  int32_t slope = dir * pressureSlope;
+  int32_t curvature = dir * pressureCurvature;
+  int32_t strongLevel = (dir > 0 ? slotSettings.sp - 512 : 512 - slotSettings.ss) - ONSET_STRONG_MARGIN;
+  int32_t peak;
+
+  if (slope < ONSET_MIN_SLOPE) peak = level;     // pressure is not rising any more
+  else if (curvature >= 0) return (0);           // still accelerating: peak can not be predicted yet
+  else peak = level + slope * slope / (-2 * curvature);  // constant deceleration until slope is zero
+
+  return (peak < (strongLevel << ONSET_FRACBITS));
+}
+
 /**
    @name getAccelFactor
    @brief calculates acceleration for mouse pointer movements 
@@ -291,16 +432,17 @@ float getAccelFactor() {
    @name acceleratedMouseMove
    @brief performs accelerated mouse pointer movement
    @param accelFactor current acceleration factor
+   @param speedFactor speed multiplier (from pressure control, 1.0 if not used)
    @return none
 */
-void acceleratedMouseMove(float accelFactor) {
+void acceleratedMouseMove(float accelFactor, float speedFactor) {
   static float accumXpos = 0;
   static float accumYpos = 0;
 
-  float moveValX = sensorData.x * (float)slotSettings.ax * accelFactor;
-  float moveValY = sensorData.y * (float)slotSettings.ay * accelFactor;
+  float moveValX = sensorData.x * (float)slotSettings.ax * accelFactor * speedFactor;
+  float moveValY = sensorData.y * (float)slotSettings.ay * accelFactor * speedFactor;
   float actSpeed =  __ieee754_sqrtf (moveValX * moveValX + moveValY * moveValY);
-  float max_speed = (float)slotSettings.ms / 3.0f;
+  float max_speed = (float)slotSettings.ms / 3.0f * speedFactor;
 
   if (actSpeed > max_speed) {
     moveValX *= (max_speed / actSpeed);
@@ -322,17 +464,151 @@ void acceleratedMouseMove(float accelFactor) {
   accumYpos -= yMove;
 }
 
+/**
+   @name accumulateScroll
+   @brief performs scrolling with sub-step resolution: fractional steps are accumulated
+          and carried over to the next update, so that slow scrolling stays smooth
+   @param steps scroll steps for this update (may be fractional, positive: down, negative: up)
+   @return none
+*/
+void accumulateScroll(float steps) {
+  static float accumScroll = 0;
+
+  if (steps == 0) accumScroll = (int)accumScroll;   // at rest: drop the fraction, whole steps beyond the report range still follow
+  else accumScroll += steps;
+  int scrollSteps = (int)accumScroll;
+
+  if (scrollSteps != 0) {
+    if (scrollSteps > 127) scrollSteps = 127;
+    else if (scrollSteps < -127) scrollSteps = -127;
+    mouseScroll(scrollSteps);
+    accumScroll -= scrollSteps;
+  }
+}
+
+/**
+   @name responseCurve
+   @brief evaluates a joystick response curve (used for building the lookup tables)
+   @param curve curve identifier (0: linear, 1-100: expo, 101-200: S-curve, 255: custom points)
+   @param x input value (0.0-1.0)
+   @return output value (0.0-1.0)
+*/
+float responseCurve(uint8_t curve, float x) {
+  if (curve == JOYSTICK_CURVE_CUSTOM) {
+    float pos = x * (JOYSTICK_CURVE_POINTS - 1);
+    int i = (int) pos;
+    if (i >= JOYSTICK_CURVE_POINTS - 1) return (slotSettings.cp[JOYSTICK_CURVE_POINTS - 1] / 100.0f);
+    return ((slotSettings.cp[i] + (slotSettings.cp[i + 1] - slotSettings.cp[i]) * (pos - i)) / 100.0f);
+  }
+  if ((curve > JOYSTICK_CURVE_SCURVE) && (curve <= 2 * JOYSTICK_CURVE_SCURVE)) {
+    float k = (curve - JOYSTICK_CURVE_SCURVE) / 100.0f;
+    return ((1.0f - k) * x + k * x * x * (3.0f - 2.0f * x));  // blend with smoothstep
+  }
+  if ((curve > JOYSTICK_CURVE_LINEAR) && (curve <= JOYSTICK_CURVE_SCURVE)) {
+    float k = curve / 100.0f;
+    return ((1.0f - k) * x + k * x * x * x);  // blend with cubic (expo)
+  }
+  return (x);
+}
+
+/**
+   @name updateJoystickCurves
+   @brief precalculates the response curve lookup tables for the joystick x/y axis (from the settings of the current slot)
+   @return none
+*/
+void updateJoystickCurves() {
+  for (int i = 0; i <= JOYSTICK_LUT_SEGMENTS; i++) {
+    float x = (float) i / JOYSTICK_LUT_SEGMENTS;
+    joystickCurveX[i] = (uint16_t) (constrain(responseCurve(slotSettings.cx, x), 0.0f, 1.0f) * JOYSTICK_AXIS_MAX + 0.5f);
+    joystickCurveY[i] = (uint16_t) (constrain(responseCurve(slotSettings.cy, x), 0.0f, 1.0f) * JOYSTICK_AXIS_MAX + 0.5f);
+  }
+}
+
 /**
    @name scaleJoystickAxis
-   @brief scales/crops coordinate values to joystick coordinates (0-1023, centered around 512)
-   @param val x/y coordinate value to be scaled
-   @return integer value for joystick coordinate
+   @brief scales/crops coordinate values to joystick coordinates via the response curve lookup table
+          (integer interpolation between the table entries)
+   @param val x/y coordinate value (deflection * acceleration) to be scaled
+   @param curve pointer to the lookup table of the response curve
+   @return joystick axis value (-32767 to 32767, centered around 0)
 */
-int scaleJoystickAxis (float val) {
-  int axis = 512 + (int) (val / 50);
-  if (axis < 0) axis = 0; 
-  else if (axis > 1023) axis = 1023;
-  return (axis);
+int32_t scaleJoystickAxis (int32_t val, const uint16_t * curve) {
+  int32_t mag = val < 0 ? -val : val;
+  int32_t axis;
+
+  if (mag >= JOYSTICK_FULLSCALE) axis = curve[JOYSTICK_LUT_SEGMENTS];
+  else {
+    int32_t pos = mag * JOYSTICK_LUT_SEGMENTS;
+    int32_t i = pos / JOYSTICK_FULLSCALE;
+    int32_t frac = pos % JOYSTICK_FULLSCALE;
+    axis = curve[i] + ((int32_t)curve[i + 1] - curve[i]) * frac / JOYSTICK_FULLSCALE;
+  }
+  return (val < 0 ? -axis : axis);
+}
+
+/**
+   @name repeatButton
+   @brief repeats the action of a direction button with a rate proportional to the deflection (time-based)
+   @param dir direction index (0-3)
+   @param button button index of the direction button
+   @param deflection deflection * acceleration in this direction (0: not deflected)
+   @return none
+*/
+void repeatButton(uint8_t dir, int button, int32_t deflection)
+{
+  static uint32_t nextRepeat[4];
+  static uint8_t repeating = 0;
+  uint32_t now = millis();
+
+  if (deflection <= 0) {
+    repeating &= ~(1 << dir);
+    return;
+  }
+
+  if ((!(repeating & (1 << dir))) || ((int32_t)(now - nextRepeat[dir]) >= 0)) {
+    handlePress(button); handleRelease(button);
+
+    // repeat rate scales linearly from minimum to maximum rate
+    if (deflection > REPEAT_FULLSCALE) deflection = REPEAT_FULLSCALE;
+    int32_t rate = slotSettings.rn + ((int32_t)slotSettings.rx - slotSettings.rn) * deflection / REPEAT_FULLSCALE;
+    uint32_t period = 1000 / (rate > 0 ? rate : 1);
+
+    // keep the schedule, unless we are more than one period late (or just started)
+    if ((!(repeating & (1 << dir))) || (now - nextRepeat[dir] > period)) nextRepeat[dir] = now + period;
+    else nextRepeat[dir] += period;
+    repeating |= (1 << dir);
+  }
+}
+
+/**
+   @name getPressureControl
+   @brief calculates the pressure deflection outside the deadband, weighted with the pressure gain
+   @return signed pressure control value (puff: positive, sip: negative; 0 if pressure control is off)
+*/
+int32_t getPressureControl() {
+  if (slotSettings.pa == PRESSURECONTROL_OFF) return (0);
+
+  int32_t p = sensorData.pressure - 512;
+  if (p > (int32_t)slotSettings.pb) p -= slotSettings.pb;
+  else if (p < -(int32_t)slotSettings.pb) p += slotSettings.pb;
+  else p = 0;
+  return (p * slotSettings.pg);
+}
+
+/**
+   @name stickJoystickAxes
+   @brief updates two joystick axes from the current stick deflection (with the axis resolution of the current slot)
+   @param select define axis for values (0: X/Y; 1: Z/Zrotate; 2: sliderLeft/sliderRight)
+   @return none
+*/
+void stickJoystickAxes(uint8_t select) {
+  int32_t axis1 = scaleJoystickAxis(sensorData.x * slotSettings.ax, joystickCurveX);
+  int32_t axis2 = scaleJoystickAxis(sensorData.y * slotSettings.ay, joystickCurveY);
+
+  if (slotSettings.jm)
+    joystickAxis16(axis1, axis2, select);
+  else
+    joystickAxis(512 + axis1 * 512 / (JOYSTICK_AXIS_MAX + 1), 512 + axis2 * 512 / (JOYSTICK_AXIS_MAX + 1), select);
 }
 
 /**
@@ -350,13 +626,41 @@ void handleMovement()
       mouseMove(sensorData.autoMoveX, sensorData.autoMoveY);
   }
 
+  // continuous pressure control (using the pressure value of this update)
+  int32_t pressureControl = getPressureControl();
+  float pressureScroll = 0, speedFactor = 1.0f;
+
+  switch (slotSettings.pa) {
+    case PRESSURECONTROL_SCROLL:
+      pressureScroll = -pressureControl / PRESSURE_SCROLL_DIVIDER;   // puff (positive): scroll up (negative steps, as AT WU)
+      if (slotSettings.stickMode != STICKMODE_SCROLL) accumulateScroll(pressureScroll);
+      break;
+    case PRESSURECONTROL_SLIDER:
+      pressureControl = constrain(pressureControl, -PRESSURE_SLIDER_FULLSCALE, PRESSURE_SLIDER_FULLSCALE);
+      if (slotSettings.jm)
+        joystickAxis16(pressureControl * JOYSTICK_AXIS_MAX / PRESSURE_SLIDER_FULLSCALE, JOYSTICK_AXIS_UNCHANGED, 2);
+      else
+        joystickAxis(constrain(512 + pressureControl * 512 / PRESSURE_SLIDER_FULLSCALE, 0, 1023), -1, 2);
+      break;
+    case PRESSURECONTROL_SPEED:
+      speedFactor = constrain(1.0f + pressureControl / PRESSURE_SPEED_DIVIDER, 0.0f, PRESSURE_SPEED_MAX);
+      break;
+  }
+
   switch (slotSettings.stickMode) {  
 
     case STICKMODE_MOUSE:   // handle mouse stick mode
-      acceleratedMouseMove(getAccelFactor());
+      acceleratedMouseMove(getAccelFactor(), speedFactor);
       break; 
      
     case STICKMODE_ALTERNATIVE:  // handle alternative actions stick mode
+      if (slotSettings.rx) {     // auto-repeat: rate proportional to deflection beyond deadzone
+        repeatButton(0, UP_BUTTON, -sensorData.y * slotSettings.ay);
+        repeatButton(1, DOWN_BUTTON, sensorData.y * slotSettings.ay);
+        repeatButton(2, LEFT_BUTTON, -sensorData.x * slotSettings.ax);
+        repeatButton(3, RIGHT_BUTTON, sensorData.x * slotSettings.ax);
+        break;
+      }
       handleButton(UP_BUTTON,  sensorData.y < 0 ? 1 : 0);
       handleButton(DOWN_BUTTON,  sensorData.y > 0 ? 1 : 0);
       handleButton(LEFT_BUTTON,  sensorData.x < 0 ? 1 : 0);
@@ -364,18 +668,19 @@ void handleMovement()
       break;
       
     case STICKMODE_JOYSTICK_XY:
-      joystickAxis(scaleJoystickAxis((float)sensorData.x * slotSettings.ax), \
-        scaleJoystickAxis((float)sensorData.y * slotSettings.ay),0);
+      stickJoystickAxes(0);
       break;
 
     case STICKMODE_JOYSTICK_ZR:
-      joystickAxis(scaleJoystickAxis((float)sensorData.x * slotSettings.ax), \
-        scaleJoystickAxis((float)sensorData.y * slotSettings.ay),1);
+      stickJoystickAxes(1);
       break;
 
     case STICKMODE_JOYSTICK_SLIDERS:
-      joystickAxis(scaleJoystickAxis((float)sensorData.x * slotSettings.ax), \
-        scaleJoystickAxis((float)sensorData.y * slotSettings.ay),2);
+      stickJoystickAxes(2);
+      break;
+
+    case STICKMODE_SCROLL:   // continuous scrolling, speed proportional to vertical deflection
+      accumulateScroll((float)sensorData.y * slotSettings.ay / SCROLL_SPEED_DIVIDER + pressureScroll);
       break;
   }
 }
@@ -31,6 +31,13 @@
 #define SIP_PUFF_SETTLE_TIME         5
 #define MIN_HOLD_TIME                3
 
+#define ONSET_SETTLED              0   // sip/puff onset: wait until pressure settled
+#define ONSET_PREDICTIVE           1   // sip/puff onset: predict pressure peak from slope and curvature
+#define ONSET_FRACBITS             4   // fractional bits of filtered pressure, slope and curvature
+#define ONSET_MIN_SLOPE            (1 << ONSET_FRACBITS)   // minimum slope (per update) for a rising pressure
+#define ONSET_STRONG_MARGIN        30  // predicted peak must stay this far below the strong sip/puff threshold
+#define ONSET_RELEASE_HYSTERESIS   15  // release hysteresis for predictive onset (pressure units)
+
 #define SIP_PUFF_STATE_IDLE        0
 #define SIP_PUFF_STATE_STARTED     1
 #define SIP_PUFF_STATE_PRESSED     2
@@ -53,6 +60,29 @@
 #define STICKMODE_JOYSTICK_XY      2
 #define STICKMODE_JOYSTICK_ZR      3
 #define STICKMODE_JOYSTICK_SLIDERS 4
+#define STICKMODE_SCROLL           5
+
+#define SCROLL_SPEED_DIVIDER  80000.0f   // divider for vertical deflection * acceleration y in scroll stick mode
+
+#define JOYSTICK_LUT_SEGMENTS   64      // number of linear segments of the joystick response curve lookup tables
+#define JOYSTICK_FULLSCALE      25600   // deflection * acceleration value which results in full joystick deflection
+#define JOYSTICK_AXIS_MAX       32767   // maximum output of the response curves (16 bit axis value)
+
+#define REPEAT_FULLSCALE        25600   // deflection * acceleration value which results in the maximum repeat rate
+
+#define PRESSURECONTROL_OFF       0
+#define PRESSURECONTROL_SCROLL    1
+#define PRESSURECONTROL_SLIDER    2
+#define PRESSURECONTROL_SPEED     3
+
+#define PRESSURE_SCROLL_DIVIDER  20000.0f  // divider for pressure deflection * gain in pressure scroll mode
+#define PRESSURE_SPEED_DIVIDER   25000.0f  // divider for pressure deflection * gain in mouse speed mode
+#define PRESSURE_SLIDER_FULLSCALE 25600    // pressure deflection * gain value which results in full slider deflection
+#define PRESSURE_SPEED_MAX       4.0f      // maximum mouse speed multiplier
+
+#define JOYSTICK_CURVE_LINEAR   0
+#define JOYSTICK_CURVE_SCURVE   100     // curve values above this (up to 200) select an S-curve
+#define JOYSTICK_CURVE_CUSTOM   255
 
 /**
    @name handleUserInteraction
@@ -61,4 +91,18 @@
 */
 void handleUserInteraction();
 
+/**
+   @name updatePressureLevels
+   @brief precalculates the pressure level lookup table (from the pressure level settings of the current slot)
+   @return none
+*/
+void updatePressureLevels();
+
+/**
+   @name updateJoystickCurves
+   @brief precalculates the response curve lookup tables for the joystick x/y axis (from the settings of the current slot)
+   @return none
+*/
+void updateJoystickCurves();
+
 #endif
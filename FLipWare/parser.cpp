@@ -17,6 +17,7 @@
 
 #include "FlipWare.h"
 #include "parser.h"
+#include "binaryframes.h"
 
 uint8_t readstate = 0;
 
@@ -67,7 +68,7 @@ uint8_t get_int(char * str, int16_t * result)
   } else fact = 1;
   if (!get_uint(str, &num)) return (0);
   *result = num * fact;
-  // Serial.println(*result);
+  // SerialOut.println(*result);
   return (1);
 }
 
@@ -87,21 +88,22 @@ void strup (char * str)   // convert to upper case letters
   }
 }
 
-void parseCommand (char * cmdstr)
+uint8_t parseCommand (char * cmdstr)
 {
   int8_t cmd = -1;
+  uint8_t result = PARSE_UNKNOWN_COMMAND;
   int16_t num = 0;
 
   cmdstr[strlen(cmdstr)+1]=0;  // to prevent exceeing the actual commandstring (when emptry string parameters are passed!)
 #ifdef DEBUG_OUTPUT_FULL
-  Serial.print("parseCommand:"); Serial.println(cmdstr);
+  SerialOut.print("parseCommand:"); SerialOut.println(cmdstr);
 #endif
   char * actpos = strtok(cmdstr, " ");  // see a nice explaination of strtok here:  http://www.reddit.com/r/arduino/comments/2h9l1l/using_the_strtok_function/
 
   if (actpos)
   {
 #ifdef DEBUG_OUTPUT_FULL
-    Serial.print("actpos:"); Serial.println(actpos);
+    SerialOut.print("actpos:"); SerialOut.println(actpos);
 #endif
     int i;
     strup(actpos);
@@ -109,7 +111,8 @@ void parseCommand (char * cmdstr)
     for (i = 0; (i < NUM_COMMANDS) && (cmd == -1); i++)
     {
       if (!strcmp_FM(actpos, (uint_farptr_t_FM)atCommands[i].atCmd))  {
-        // Serial.print ("partype="); Serial.println (pgm_read_byte_near(&(atCommands[i].partype)));
+        result = PARSE_INVALID_PARAMETER;
+        // SerialOut.print ("partype="); SerialOut.println (pgm_read_byte_near(&(atCommands[i].partype)));
         switch (pgm_read_byte_near(&(atCommands[i].partype)))
         {
           case PARTYPE_UINT: actpos = strtok(NULL, " ");  if (get_uint(actpos, &num)) cmd = i ; break;
@@ -122,11 +125,12 @@ void parseCommand (char * cmdstr)
   }
 
   if (cmd > -1) {
-    //Serial.print("cmd:");Serial.print(cmd);Serial.print("numpar:");
-    //Serial.print(num);Serial.print("stringpar:");Serial.println(actpos);
-    performCommand(cmd, num, actpos, 0);
+    //SerialOut.print("cmd:");SerialOut.print(cmd);SerialOut.print("numpar:");
+    //SerialOut.print(num);SerialOut.print("stringpar:");SerialOut.println(actpos);
+    return (performCommand(cmd, num, actpos, 0));
   }
-  else Serial.println("???");       // command not recognized!
+  SerialOut.println("???");       // command not recognized!
+  return (result);
 }
 
 
@@ -137,6 +141,8 @@ void parseByte (int newByte)  // parse an incoming commandbyte from serial inter
 
   if (CimParserActive)
     parse_CIM_protocol(newByte);   // handle AsTeRICS CIM protocol messages !
+  else if (frameParserActive)
+    parseFrameByte(newByte);       // handle binary frames (see binaryframes.cpp)
   else
   {
     switch (readstate) {
@@ -146,6 +152,10 @@ void parseByte (int newByte)  // parse an incoming commandbyte from serial inter
           readstate++;  // switch to AsTeRICS CIM protocol parser
           CimParserActive = 1;
         }
+        if (newByte == FRAME_SYNC) {  // switch to binary frame parser
+          frameParserActive = 1;
+          parseFrameByte(newByte);
+        }
         break;
       case 1:
         if ((newByte == 'T') || (newByte == 't')) readstate++; else readstate = 0;
@@ -153,7 +163,7 @@ void parseByte (int newByte)  // parse an incoming commandbyte from serial inter
       case 2:
         if ((newByte == '\r') || (newByte == '\n')) // AT reply: "OK"
         {
-          Serial.println("OK");
+          SerialOut.println("OK");
           readstate = 0;
         }
         else if (newByte == ' ') {
@@ -169,7 +179,149 @@ void parseByte (int newByte)  // parse an incoming commandbyte from serial inter
         }
         else workingmem[cmdlen++] = newByte;
         break;
-default: err: Serial.println("?"); readstate = 0;
+default: err: SerialOut.println("?"); readstate = 0;
     }
   }
 }
+
+
+/**
+   static variables for serial input buffering
+*/
+uint8_t rxBuffer[RX_BUFFER_SIZE];
+uint16_t rxLen = 0;
+uint8_t rxDiscarding = 0;   // an overlong line is dismissed until the next line end
+
+uint16_t expectedSeq = 0;   // next expected sequence number of sequenced commands
+uint8_t ackPending = 0;     // sequenced commands were performed since the last ACK
+
+/**
+   @name parseLine
+   @brief handles a complete AT command line (without line end)
+   @param line pointer to the line (starting with "AT" or "at")
+   @param len length of the line
+   @return PARSE_OK if the command was performed, an error code otherwise (see parser.h)
+*/
+uint8_t parseLine(uint8_t * line, uint16_t len)
+{
+  if ((len < 2) || ((line[1] != 'T') && (line[1] != 't'))) return (PARSE_UNKNOWN_COMMAND);   // not an AT command: ignore
+  if (len == 2) {
+    SerialOut.println("OK");
+    return (PARSE_OK);
+  }
+  if (line[2] != ' ') {
+    SerialOut.println("?");
+    return (PARSE_UNKNOWN_COMMAND);
+  }
+  memcpy(workingmem, line + 3, len - 3);
+  workingmem[len - 3] = 0;
+  return (parseCommand((char *)workingmem));
+}
+
+/**
+   @name parseSequencedLine
+   @brief handles a command line with sequence number prefix ("#<seq> AT ..."), replies NAK for errors
+   @param line pointer to the line (starting with '#')
+   @param len length of the line
+   @param overlong if set, the line was too long for the command buffer: not performed, only the prefix is parsed
+   @return none
+*/
+void parseSequencedLine(uint8_t * line, uint16_t len, uint8_t overlong)
+{
+  uint16_t i = 1;
+  uint32_t seq = 0;
+
+  while ((i < len) && (line[i] >= '0') && (line[i] <= '9') && (seq <= 0xffff))
+    seq = seq * 10 + (line[i++] - '0');
+  if ((i == 1) || (i >= len) || (line[i] != ' ') || (seq > 0xffff)) {
+    SerialOut.println("?");
+    return;
+  }
+
+  uint8_t result;
+  if (seq && (seq != expectedSeq)) result = PARSE_SEQUENCE_ERROR;   // lost or repeated line: not performed
+  else {
+    result = overlong ? PARSE_LINE_TOO_LONG : parseLine(line + i + 1, len - i - 1);
+    expectedSeq = seq + 1;
+    ackPending = 1;
+  }
+  if ((result == PARSE_SEQUENCE_ERROR) && ackPending) {
+    // acknowledge the commands performed so far, so the host knows where to resend from
+    SerialOut.print("ACK "); SerialOut.println((uint16_t)(expectedSeq - 1));
+    ackPending = 0;
+  }
+  if (result != PARSE_OK) {
+    SerialOut.print("NAK "); SerialOut.print(seq); SerialOut.print(" "); SerialOut.println(result);
+  }
+}
+
+void processSerialInput()
+{
+  uint8_t lines = 0;
+  uint16_t pos = 0;
+
+  // block read of available bytes into the receive buffer
+  int count = Serial.available();
+  if (count > RX_BUFFER_SIZE - rxLen) count = RX_BUFFER_SIZE - rxLen;
+  if (count > 0) rxLen += Serial.readBytes(rxBuffer + rxLen, count);
+
+  // a long output (e.g. AT LA) is in progress: following commands wait, so that replies keep their order
+  while ((pos < rxLen) && (lines < PARSE_LINE_BUDGET) && !serialOutputBusy()) {
+    uint8_t * start = rxBuffer + pos;
+    uint16_t remaining = rxLen - pos;
+
+    // binary protocols (CIM, frames) or a byte-wise AT command (after a frame timeout): parse bytewise
+    if (CimParserActive || frameParserActive || readstate) {
+      parseByte(*start);
+      pos++;
+      continue;
+    }
+    if (!rxDiscarding) {
+      // skip everything outside AT commands (e.g. line ends), switch to binary protocols on their sync bytes
+      if ((*start != 'A') && (*start != 'a') && (*start != '#')) {
+        if ((*start == '@') || (*start == FRAME_SYNC)) parseByte(*start);
+        pos++;
+        continue;
+      }
+    }
+
+    // line framing: find the next line end
+    uint8_t * cr = (uint8_t *)memchr(start, '\r', remaining);
+    uint8_t * lf = (uint8_t *)memchr(start, '\n', remaining);
+    uint8_t * end = (cr && (!lf || (cr < lf))) ? cr : lf;
+
+    if (!end) {
+      // incomplete line: wait for more data, unless the line is too long for the command buffer
+      if (!rxDiscarding && (remaining >= WORKINGMEM_SIZE - 4)) {
+        SerialOut.println("E: command line too long");
+        if (*start == '#') parseSequencedLine(start, remaining, 1);
+        rxDiscarding = 1;
+      }
+      if (rxDiscarding) pos = rxLen;
+      break;
+    }
+
+    uint16_t len = end - start;
+    if (rxDiscarding) rxDiscarding = 0;
+    else if (len >= WORKINGMEM_SIZE - 4) {
+      SerialOut.println("E: command line too long");
+      if (*start == '#') parseSequencedLine(start, len, 1);
+    }
+    else if (*start == '#') parseSequencedLine(start, len, 0);
+    else parseLine(start, len);
+    pos += len + 1;
+    lines++;
+  }
+
+  // remove processed bytes from the receive buffer
+  if (pos) {
+    memmove(rxBuffer, rxBuffer + pos, rxLen - pos);
+    rxLen -= pos;
+  }
+
+  // cumulative acknowledge of the sequenced commands of this batch
+  if (ackPending) {
+    SerialOut.print("ACK "); SerialOut.println((uint16_t)(expectedSeq - 1));
+    ackPending = 0;
+  }
+}
@@ -21,6 +21,28 @@
 #define PARTYPE_INT   2
 #define PARTYPE_STRING  3
 
+#define RX_BUFFER_SIZE     512   // receive buffer for serial input (bytes)
+#define PARSE_LINE_BUDGET  8     // maximum number of command lines performed per call of processSerialInput
+
+/**
+   constant definitions of parseCommand result codes
+*/
+#define PARSE_OK                 0
+#define PARSE_UNKNOWN_COMMAND    1
+#define PARSE_INVALID_PARAMETER  2
+#define PARSE_SEQUENCE_ERROR     3
+#define PARSE_COMMAND_FAILED     4   // command was performed but failed (e.g. slot not found)
+#define PARSE_LINE_TOO_LONG      5
+
+/**
+   @name processSerialInput
+   @brief reads the available serial input into the receive buffer, performs complete AT command lines
+          (max. PARSE_LINE_BUDGET per call, overlong lines are reported and dismissed)
+          and passes binary protocol data (CIM, frames) to parseByte. Called frequently from loop().
+   @return none
+*/
+void processSerialInput();
+
 /**
    @name parseByte
    @brief parses AT command input from serial interface
@@ -34,8 +56,9 @@ void parseByte (int newByte);
    @name parseCommand
    @brief parses a detected AT command
    @param cmdstr pointer to a string which contains the AT command identifier and parameter
-   @return none
+   @return PARSE_OK if the command was performed, PARSE_UNKNOWN_COMMAND, PARSE_INVALID_PARAMETER or
+           PARSE_COMMAND_FAILED otherwise
 */
-void parseCommand (char * cmdstr);
+uint8_t parseCommand (char * cmdstr);
 
 #endif
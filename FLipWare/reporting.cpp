@@ -23,6 +23,9 @@
   static variables for report management
 */
 uint8_t reportRawValues = 0;
+uint16_t reportInterval = REPORT_INTERVAL_DEFAULT;
+uint8_t eventSubscriptions = 0;
+uint8_t reportFormat = REPORT_FORMAT_LEGACY;
 
 /**
    @name makehex
@@ -48,9 +51,9 @@ void makehex(uint32_t val, char* str) {
 
 /** 
  * @brief Print current to given stream
- * @param S Stream to send the AT commands to; in our case Serial or a File
+ * @param S Print / Stream to send the AT commands to; in our case SerialOut, a File or a query filter
  */
-void printCurrentSlot(Stream *S)
+void printCurrentSlot(Print *S)
 {
   char tmp[10];
   S->println(slotSettings.slotName);
@@ -79,6 +82,28 @@ void printCurrentSlot(Stream *S)
   S->print("AT KL "); S->println(slotSettings.kbdLayout);
   S->print("AT SB "); S->println(slotSettings.sb);
   S->print("AT SC "); makehex(slotSettings.sc, tmp); S->println(tmp);
+  S->print("AT JM "); S->println(slotSettings.jm);
+  S->print("AT CX "); S->println(slotSettings.cx);
+  S->print("AT CY "); S->println(slotSettings.cy);
+  S->print("AT CP ");
+  for (int i = 0; i < JOYSTICK_CURVE_POINTS; i++) {
+    S->print(slotSettings.cp[i]);
+    S->print(i < JOYSTICK_CURVE_POINTS - 1 ? " " : "\n");
+  }
+  S->print("AT FC "); S->println(slotSettings.fc);
+  S->print("AT FB "); S->println(slotSettings.fb);
+  S->print("AT TF "); S->println(slotSettings.tf);
+  S->print("AT TW "); S->println(slotSettings.tw);
+  S->print("AT RN "); S->println(slotSettings.rn);
+  S->print("AT RX "); S->println(slotSettings.rx);
+  S->print("AT PA "); S->println(slotSettings.pa);
+  S->print("AT PB "); S->println(slotSettings.pb);
+  S->print("AT PG "); S->println(slotSettings.pg);
+  S->print("AT PO "); S->println(slotSettings.po);
+  for (int i = 0; i < PRESSURE_LEVELS; i++) {
+    S->print("AT PZ "); S->print(i); S->print(" ");
+    S->print(slotSettings.pz[i][0]); S->print(" "); S->println(slotSettings.pz[i][1]);
+  }
 
   for (int i = 0; i < NUMBER_OF_BUTTONS; i++)
   {
@@ -110,29 +135,147 @@ void printCurrentSlot(Stream *S)
 
 void reportValues()
 {
-  static uint8_t valueReportCount = 0;
-  
+  static uint32_t lastValueReport = 0;
+  char line[REPORT_LINE_LEN];
+  int len;
+
   if (!reportRawValues)   return;
+  if (millis() - lastValueReport < reportInterval) return;
 
-  if (valueReportCount++ > 50/UPDATE_INTERVAL) {      // report raw values approx. every 50ms !
-    int32_t u=sensorData.yRaw+512; int32_t d=512-sensorData.yRaw;   // just for GUI compatibility with V2 (bar displays up/down)
-    int32_t l=sensorData.xRaw+512; int32_t r=512-sensorData.xRaw;   // just for GUI compatibility with V2 (bar displays left/right)
-    Serial.print("VALUES:"); Serial.print(sensorData.pressure); Serial.print(",");
-    Serial.print(u); Serial.print(","); Serial.print(d); Serial.print(",");
-    Serial.print(l); Serial.print(","); Serial.print(r); Serial.print(",");
-    Serial.print(sensorData.xRaw); Serial.print(","); Serial.print(sensorData.yRaw); Serial.print(",");
-    for (uint8_t i = 0; i < NUMBER_OF_BUTTONS; i++)
-    {
-      if (buttonStates & (1 << i)) Serial.print("1");
-      else Serial.print("0");
+  int32_t u=sensorData.yRaw+512; int32_t d=512-sensorData.yRaw;   // just for GUI compatibility with V2 (bar displays up/down)
+  int32_t l=sensorData.xRaw+512; int32_t r=512-sensorData.xRaw;   // just for GUI compatibility with V2 (bar displays left/right)
+  len = snprintf(line, sizeof(line), "VALUES:%d,%ld,%ld,%ld,%ld,%d,%d,", sensorData.pressure,
+                 (long)u, (long)d, (long)l, (long)r, sensorData.xRaw, sensorData.yRaw);
+  uint8_t reportedButtons = reportFormat == REPORT_FORMAT_EXTENDED ? NUMBER_OF_BUTTONS : NUMBER_OF_LEGACY_BUTTONS;
+  for (uint8_t i = 0; i < reportedButtons; i++)
+    line[len++] = (buttonStates & (1UL << i)) ? '1' : '0';
+  len += snprintf(line + len, sizeof(line) - len, ",%d,%d,%d\r\n", actSlot,
+                  sensorData.xDriftComp, sensorData.yDriftComp);
+
+  queueTelemetry((const uint8_t *)line, len);   // drops the oldest records if the host does not read fast enough
+  lastValueReport = millis();
+}
+
+void printStatistics()
+{
+  SerialOut.print("STATISTICS:HID mouse reports="); SerialOut.print(hidStatistics.mouseReports);
+  SerialOut.print(",avoided="); SerialOut.print(hidStatistics.mouseAvoided);
+  SerialOut.print(",joystick reports="); SerialOut.print(hidStatistics.joystickReports);
+  SerialOut.print(",avoided="); SerialOut.print(hidStatistics.joystickAvoided);
+  SerialOut.print(",keyboard reports="); SerialOut.print(hidStatistics.keyboardReports);
+  SerialOut.print(",queue full="); SerialOut.print(hidStatistics.keyboardQueueFull);
+  SerialOut.print(",typing dropped="); SerialOut.println(hidStatistics.typingDropped);
+  for (uint8_t t = 0; t < HID_TRANSPORTS; t++) {
+    struct HIDTransportStatistics * st = &hidTransportStatistics[t];
+    SerialOut.print(t == HID_TRANSPORT_USB ? "STATISTICS:TRANSPORT usb sent=" : "STATISTICS:TRANSPORT bt sent=");
+    SerialOut.print(st->sent);
+    SerialOut.print(",merged="); SerialOut.print(st->merged);
+    SerialOut.print(",dropped="); SerialOut.print(st->dropped);
+    SerialOut.print(",latency us avg="); SerialOut.print(st->sent ? st->latencyTotal / st->sent : 0);
+    SerialOut.print(",max="); SerialOut.println(st->latencyMax);
+  }
+  SerialOut.print("STATISTICS:SERIAL telemetry dropped="); SerialOut.print(serialOutStatistics.telemetryDropped);
+  SerialOut.print(",reply discarded="); SerialOut.println(serialOutStatistics.replyDiscarded);
+  SerialOut.print("STATISTICS:BT protocol="); SerialOut.print(btProtocol == BT_PROTOCOL_FRAMED ? "framed" : "legacy");
+  SerialOut.print(",reports="); SerialOut.print(btStatistics.reportsSent);
+  SerialOut.print(",acks requested="); SerialOut.print(btStatistics.acksRequested);
+  SerialOut.print(",acks received="); SerialOut.print(btStatistics.acksReceived);
+  SerialOut.print(",framing errors="); SerialOut.print(btStatistics.framingErrors);
+  SerialOut.print(",baud="); SerialOut.print(btBaudrate);
+  SerialOut.print(",wire time us mouse="); SerialOut.print(btStatistics.wireTime[0]);
+  SerialOut.print(",keyboard="); SerialOut.print(btStatistics.wireTime[1]);
+  SerialOut.print(",joystick="); SerialOut.print(btStatistics.wireTime[2]);
+  SerialOut.print(",total="); SerialOut.println(btStatistics.wireTimeTotal);
+  SerialOut.print("STATISTICS:BT tx high water="); SerialOut.print(btStatistics.txHighWater);
+  SerialOut.print(",tx overflows="); SerialOut.print(btStatistics.txOverflows);
+  SerialOut.print(",keyboard dropped="); SerialOut.print(btStatistics.keyboardDropped);
+  SerialOut.print(",send time us max="); SerialOut.print(btStatistics.sendTimeMax);
+  SerialOut.print(",total="); SerialOut.println(btStatistics.sendTimeTotal);
+  for (uint8_t i = BT_PRIORITY_HIGH; i <= BT_PRIORITY_LOW; i++) {
+    SerialOut.print(i == BT_PRIORITY_HIGH ? "STATISTICS:BT queue high reports=" : ",low reports=");
+    SerialOut.print(btStatistics.queuedReports[i]);
+    SerialOut.print(",delay us avg=");
+    SerialOut.print(btStatistics.queuedReports[i] ? btStatistics.queueDelayTotal[i] / btStatistics.queuedReports[i] : 0);
+    SerialOut.print(",max="); SerialOut.print(btStatistics.queueDelayMax[i]);
+  }
+  SerialOut.println("");
+}
+
+/**
+   QueryFilter class
+   passes only the lines of printCurrentSlot which belong to the queried AT command to SerialOut.
+   The button actions (starting with the first "AT BM" line) are settings of the buttons, not of the slot:
+   they are never passed (e.g. AT QU KW does not return the keystrings of the buttons).
+*/
+class QueryFilter : public Print {
+  public:
+    QueryFilter(const char * name) {
+      snprintf(prefix, sizeof(prefix), "AT %.2s ", name);
     }
-    Serial.print(",");
-    Serial.print(actSlot);
-    Serial.print(",");
-    Serial.print(sensorData.xDriftComp);
-    Serial.print(",");
-    Serial.print(sensorData.yDriftComp);
-    Serial.println("");
-    valueReportCount = 0;
+    virtual size_t write(uint8_t c) {
+      if (len < QUERY_LINE_LEN) line[len++] = c;
+      else line[QUERY_LINE_LEN - 1] = c;   // overlong line: keep the line end
+      if (c == '\n') {
+        if (!strncmp(line, "AT BM ", 6)) buttonActions = 1;
+        if ((!buttonActions) && (!strncmp(line, prefix, strlen(prefix)))) {
+          SerialOut.write((uint8_t *)line, len);
+          found = 1;
+        }
+        len = 0;
+      }
+      return (1);
+    }
+    using Print::write;
+    uint8_t found = 0;
+  private:
+    char prefix[sizeof("AT XX ")];
+    char line[QUERY_LINE_LEN];
+    uint8_t len = 0;
+    uint8_t buttonActions = 0;
+};
+
+void printQuery(char * name)
+{
+  for (char * c = name; *c; c++)
+    if ((*c >= 'a') && (*c <= 'z')) *c = *c - 'a' + 'A';
+
+  if (!strcmp(name, "SLOT")) {
+    SerialOut.print("SLOT "); SerialOut.print(actSlot); SerialOut.print(" "); SerialOut.println(slotSettings.slotName);
+    return;
+  }
+  if (!strcmp(name, "BTLINK")) {
+    SerialOut.print("BTLINK "); SerialOut.println(isBluetoothConnected());
+    return;
+  }
+  if (!strcmp(name, "CALIBRATION")) {
+    SerialOut.print("CALIBRATION "); SerialOut.println(sensorData.calibrating);
+    return;
+  }
+
+  // slot settings: AT command names have 2 letters
+  if ((strlen(name) != 2) || (name[0] < 'A') || (name[0] > 'Z') || (name[1] < 'A') || (name[1] > 'Z')) {
+    SerialOut.println("E: invalid query name");
+    return;
+  }
+  QueryFilter filter(name);
+  printCurrentSlot(&filter);
+  if (!filter.found) SerialOut.println("?");
+}
+
+void reportEvent(uint8_t event, int value, const char * name)
+{
+  if (!(eventSubscriptions & event)) return;
+
+  SerialOut.print("EVENT:");
+  switch (event) {
+    case EVENT_SLOT:        SerialOut.print("SLOT "); break;
+    case EVENT_CALIBRATION: SerialOut.print("CALIBRATION "); break;
+    case EVENT_BT:          SerialOut.print("BT "); break;
+    case EVENT_IR:          SerialOut.print("IR "); break;
+  }
+  SerialOut.print(value);
+  if (name) {
+    SerialOut.print(" "); SerialOut.print(name);
   }
+  SerialOut.println("");
 }
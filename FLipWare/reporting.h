@@ -19,23 +19,67 @@
 #define REPORT_NONE  0
 #define REPORT_ALL_SLOTS 1
 
+#define EVENT_SLOT         (1 << 0)   // event: slot changed
+#define EVENT_CALIBRATION  (1 << 1)   // event: calibration finished
+#define EVENT_BT           (1 << 2)   // event: BT link up / down
+#define EVENT_IR           (1 << 3)   // event: IR command recorded
+#define QUERY_LINE_LEN     64         // maximum length of a settings line for AT QU
+
+#define REPORT_INTERVAL_DEFAULT  50     // default interval for raw value reports (milliseconds)
+#define REPORT_INTERVAL_MAX      1000   // maximum interval for raw value reports (milliseconds)
+#define REPORT_LINE_LEN          128    // maximum length of a raw value report line
+
+#define REPORT_FORMAT_LEGACY     0      // VALUES reports and AT LA as in v3.6 (buttons 1-19)
+#define REPORT_FORMAT_EXTENDED   1      // also the pressure level buttons 20-25 (see AT RF)
+
 /**
    extern declaration of static variables
    which shall be accessed from other modules
 */
 extern uint8_t reportRawValues;
+extern uint16_t reportInterval;
+extern uint8_t eventSubscriptions;
+extern uint8_t reportFormat;
 
 /** 
  * @brief Print current to given stream
- * @param S Stream to send the AT commands to; in our case Serial or a File
+ * @param S Print / Stream to send the AT commands to; in our case SerialOut, a File or a query filter
  */
-void printCurrentSlot(Stream *S);
+void printCurrentSlot(Print *S);
+
+/**
+   @name printQuery
+   @brief prints the setting(s) of the current slot with the given AT command name (e.g. "AX" -> "AT AX 40"),
+          or a device state ("SLOT" -> "SLOT <nr> <name>", "BTLINK" -> "BTLINK <0/1>", "CALIBRATION" -> "CALIBRATION <0/1>")
+   @param name setting or state name
+   @return none
+*/
+void printQuery(char * name);
+
+/**
+   @name reportEvent
+   @brief prints an event message ("EVENT:<type> <value> [<name>]"), if the event type was subscribed (AT EV)
+   @param event event type (EVENT_SLOT, EVENT_CALIBRATION, EVENT_BT, EVENT_IR)
+   @param value event value (e.g. slot number)
+   @param name optional name (e.g. slot name, IR command name), may be 0
+   @return none
+*/
+void reportEvent(uint8_t event, int value, const char * name);
 
 /**
    @name reportValues
    @brief prints the current live movement data and button values to the serial interface
+   @note The report line is queued as one telemetry record (see serialout.h), so a slow host
+         never blocks the main loop and reports never split AT replies.
    @return none
 */
 void reportValues();
 
+/**
+   @name printStatistics
+   @brief prints runtime statistics (e.g. sent and avoided HID reports) to the serial interface
+   @return none
+*/
+void printStatistics();
+
 #endif
@@ -53,6 +53,20 @@ uint8_t reportXValues = 0, reportYValues = 0;
 pressure_type_t sensor_pressure = NO_PRESSURE;
 force_type_t sensor_force = NO_FORCE;
 
+/**
+   @brief Tremor filter state (biquad coefficients and delay elements for x/y), used by core1
+*/
+struct TremorFilter {
+  int32_t b0, b1, b2, a1, a2;    // coefficients (TREMOR_COEFF_BITS fixed point, a0 normalized to 1)
+  int32_t x1[2], x2[2], y1[2], y2[2];
+  uint8_t freq, width;           // settings the coefficients were calculated for
+  uint32_t interval;             // sampling interval (microseconds) the coefficients were calculated for
+  uint32_t intervalEstimate;     // current sampling interval estimate (microseconds, 4 fractional bits)
+  uint32_t lastSample;           // timestamp of last sample (microseconds)
+  uint8_t gaps;                  // number of consecutive intervals which were ignored as gaps
+  uint8_t active;
+} tremorFilter = {0};
+
 /**
    @name configureNAU
    @brief initialises the NAU7802 chip for desired sampling rate and gain
@@ -428,6 +442,82 @@ void readPressure(struct I2CSensorValues *data)
   mutex_exit(&(data->sensorDataMutex));
 }
 
+/**
+   @name updateTremorFilter
+   @brief tracks the force sampling interval and (re)calculates the notch coefficients if the settings
+          or the sampling rate changed. [called from core 1]
+   @param freq: center frequency in 0.1 Hz (0: filter off)
+   @param width: bandwidth in 0.1 Hz (a wide band results in a bandstop characteristic)
+   @return true if the filter is active
+*/
+static uint8_t updateTremorFilter(uint8_t freq, uint8_t width)
+{
+  uint32_t now = micros();
+  uint32_t interval = now - tremorFilter.lastSample;
+  tremorFilter.lastSample = now;
+
+  // estimate sampling interval (exponential average, 4 fractional bits), gaps (e.g. I2C hangs) are ignored
+  uint32_t estimate = tremorFilter.intervalEstimate >> 4;
+  if ((!estimate) || (interval < estimate / 2) || (tremorFilter.gaps >= TREMOR_GAP_COUNT)) {
+    tremorFilter.intervalEstimate = interval << 4;
+    tremorFilter.gaps = 0;
+  }
+  else if (interval < estimate * 2) {
+    tremorFilter.intervalEstimate += ((int32_t)(interval << 4) - (int32_t)tremorFilter.intervalEstimate) / 16;
+    tremorFilter.gaps = 0;
+  }
+  else tremorFilter.gaps++;   // a long interval in every sample means the sampling rate dropped
+
+  if (freq == 0) return (tremorFilter.active = 0);
+
+  estimate = tremorFilter.intervalEstimate >> 4;
+  uint32_t deviation = estimate > tremorFilter.interval ? estimate - tremorFilter.interval : tremorFilter.interval - estimate;
+
+  if ((freq != tremorFilter.freq) || (width != tremorFilter.width) ||
+      (deviation > tremorFilter.interval / TREMOR_RATE_TOLERANCE)) {
+
+    tremorFilter.freq = freq;
+    tremorFilter.width = width;
+    tremorFilter.interval = estimate;
+
+    // RBJ notch: w0 = 2*pi*f0/fs, Q = f0 / bandwidth
+    float fs = 1000000.0f / (estimate ? estimate : 1);
+    float f0 = freq / 10.0f;
+    float bw = (width < TREMOR_MIN_WIDTH ? TREMOR_MIN_WIDTH : width) / 10.0f;
+    if (f0 >= fs * 0.45f) return (tremorFilter.active = 0);  // not possible at this sampling rate
+
+    float w0 = 2.0f * PI * f0 / fs;
+    float alpha = sinf(w0) * bw / (2.0f * f0);
+    float a0 = 1.0f + alpha;
+    float scale = (1 << TREMOR_COEFF_BITS) / a0;
+    tremorFilter.b0 = tremorFilter.b2 = (int32_t) lroundf(scale);
+    tremorFilter.b1 = tremorFilter.a1 = (int32_t) lroundf(-2.0f * cosf(w0) * scale);
+    tremorFilter.a2 = (int32_t) lroundf((1.0f - alpha) * scale);
+    tremorFilter.active = 1;
+  }
+  return (tremorFilter.active);
+}
+
+/**
+   @name applyTremorFilter
+   @brief notch / bandstop biquad (direct form I, fixed point) for one force axis. [called from core 1]
+   @param in: new input value
+   @param axis: 0 for x, 1 for y
+   @return filtered value
+*/
+static int32_t applyTremorFilter(int32_t in, uint8_t axis)
+{
+  int64_t acc = (int64_t)tremorFilter.b0 * in + (int64_t)tremorFilter.b1 * tremorFilter.x1[axis]
+                + (int64_t)tremorFilter.b2 * tremorFilter.x2[axis]
+                - (int64_t)tremorFilter.a1 * tremorFilter.y1[axis] - (int64_t)tremorFilter.a2 * tremorFilter.y2[axis];
+  int32_t out = (int32_t)(acc >> TREMOR_COEFF_BITS);
+
+  tremorFilter.x2[axis] = tremorFilter.x1[axis]; tremorFilter.x1[axis] = in;
+  tremorFilter.y2[axis] = tremorFilter.y1[axis]; tremorFilter.y1[axis] = out;
+  return (out);
+}
+
+
 /**
    @name readForce
    @brief updates and processes new  x/y sensor values from NAU7802. [called from core 1]
@@ -475,9 +565,24 @@ void readForce(struct I2CSensorValues *data)
   }
 
   // here we provide new X/Y values for further processing by core 0 !
+  mutex_enter_blocking(&(data->sensorDataMutex));
+  uint8_t freq = data->tremorFreq, width = data->tremorWidth;
+  mutex_exit(&(data->sensorDataMutex));
+
+  if (updateTremorFilter(freq, width) && (!data->calib_now)) {
+    currentX = applyTremorFilter(currentX, 0);
+    currentY = applyTremorFilter(currentY, 1);
+  }
+  else {
+    // clear delay elements
+    memset(tremorFilter.x1, 0, sizeof(tremorFilter.x1)); memset(tremorFilter.x2, 0, sizeof(tremorFilter.x2));
+    memset(tremorFilter.y1, 0, sizeof(tremorFilter.y1)); memset(tremorFilter.y2, 0, sizeof(tremorFilter.y2));
+  }
+
   mutex_enter_blocking(&(data->sensorDataMutex));
   data->xRaw =  currentX;
   data->yRaw =  currentY;
+  data->timestamp = micros();
   mutex_exit(&(data->sensorDataMutex));
 }
 
@@ -542,6 +647,107 @@ void applyDeadzone(struct SensorData * sensorData, struct SlotSettings * slotSet
   }
 }
 
+/**
+   @brief x/y filter timing: measured update interval and the coefficients which depend on it, used by core0
+*/
+struct SmoothingTiming {
+  uint32_t lastUpdate;           // timestamp of last update (microseconds)
+  uint32_t intervalEstimate;     // update interval estimate (microseconds, 4 fractional bits)
+  uint32_t ticks;                // 2*pi*interval*0.1Hz in Q16 the coefficients were calculated for
+  int32_t derivateAlpha;         // smoothing factor of the speed estimation (Q16)
+  int32_t speedScale;            // converts the speed per update to the speed per UPDATE_INTERVAL (Q16)
+} smoothingTiming = {0, (UPDATE_INTERVAL * 1000UL) << 4, 0, 0, 0};
+
+/**
+   @name filterAlpha
+   @brief calculates the smoothing factor of a first order lowpass for the given cutoff frequency
+   @param cutoff: cutoff frequency in 0.1 Hz
+   @return smoothing factor in Q16 (alpha = w / (1 + w), w = 2*pi*cutoff*update interval)
+*/
+static int32_t filterAlpha(uint32_t cutoff)
+{
+  uint32_t w = cutoff * smoothingTiming.ticks;
+  return (65536 - (int32_t) (0xFFFFFFFFUL / (65536 + w)));
+}
+
+/**
+   @name updateSmoothingTiming
+   @brief measures the update interval and recalculates the interval dependent coefficients if it changed
+   @return none
+*/
+static void updateSmoothingTiming()
+{
+  uint32_t now = micros();
+  uint32_t interval = now - smoothingTiming.lastUpdate;
+  smoothingTiming.lastUpdate = now;
+
+  // estimate update interval (exponential average, 4 fractional bits), gaps (e.g. I2C hangs) are limited
+  uint32_t estimate = smoothingTiming.intervalEstimate >> 4;
+  interval = constrain(interval, estimate / 2, estimate * 2);
+  interval = constrain(interval, FILTER_MIN_INTERVAL, FILTER_MAX_INTERVAL);
+  smoothingTiming.intervalEstimate += ((int32_t)(interval << 4) - (int32_t)smoothingTiming.intervalEstimate) / 16;
+
+  uint32_t ticks = (smoothingTiming.intervalEstimate * FILTER_CUTOFF_PER_US) >> 20;
+  if (ticks != smoothingTiming.ticks) {
+    smoothingTiming.ticks = ticks;
+    smoothingTiming.derivateAlpha = filterAlpha(FILTER_DERIVATE_CUTOFF);
+    smoothingTiming.speedScale = (int32_t) (((uint64_t) UPDATE_INTERVAL * 1000 << 20) / smoothingTiming.intervalEstimate);
+  }
+}
+
+/**
+   @name filterAxis
+   @brief One-Euro filter for one axis (fixed point, state: filtered value and filtered speed)
+   @param val: new input value
+   @param state: pointer to filter state (value and speed, in FILTER_FRACBITS fixed point)
+   @param slotSettings: pointer to SlotSettings struct (minimum cutoff and beta)
+   @return filtered value
+*/
+static int filterAxis(int val, int32_t * state, struct SlotSettings * slotSettings)
+{
+  int32_t in = (int32_t) val << FILTER_FRACBITS;
+
+  // estimate speed (units per UPDATE_INTERVAL, independent of the update rate) and smooth it with a fixed cutoff
+  int32_t speed = (int32_t) (((int64_t)(in - state[0]) * smoothingTiming.speedScale) >> 16);
+  state[1] += (int32_t) (((int64_t)(speed - state[1]) * smoothingTiming.derivateAlpha) >> 16);
+
+  // cutoff rises with speed: small cutoff at rest (less jitter), high cutoff during fast movements (less lag)
+  uint32_t cutoff = slotSettings->fc + ((uint32_t) abs(state[1]) * slotSettings->fb >> FILTER_FRACBITS) / FILTER_BETA_DIVIDER;
+  if (cutoff > FILTER_MAX_CUTOFF) cutoff = FILTER_MAX_CUTOFF;
+
+  state[0] += (int32_t) (((int64_t)(in - state[0]) * filterAlpha(cutoff)) >> 16);
+  return (state[0] / (1 << FILTER_FRACBITS));  // round towards zero (no residual movement at rest)
+}
+
+/**
+   @name applySmoothing
+   @brief applies an adaptive lowpass filter (One-Euro filter) to the x/y values (in sensorData struct)
+          and updates force / angle from the filtered values. [called from core 0]
+   @param sensorData: pointer to SensorData struct, used by core0
+   @param slotSettings: pointer to SlotSettings struct, used by core0
+   @return none
+*/
+void applySmoothing(struct SensorData * sensorData, struct SlotSettings * slotSettings)
+{
+  static int32_t xState[2] = {0, 0};
+  static int32_t yState[2] = {0, 0};
+
+  updateSmoothingTiming();
+  if (slotSettings->fc == 0) {
+    // filter off: keep state in sync for a smooth start when activated
+    xState[0] = (int32_t) sensorData->x << FILTER_FRACBITS; xState[1] = 0;
+    yState[0] = (int32_t) sensorData->y << FILTER_FRACBITS; yState[1] = 0;
+    return;
+  }
+
+  sensorData->x = filterAxis(sensorData->x, xState, slotSettings);
+  sensorData->y = filterAxis(sensorData->y, yState, slotSettings);
+
+  // force and angle follow the filtered values (deadzone / acceleration checks must see the filter decay)
+  sensorData->force = __ieee754_sqrtf((float)sensorData->x * sensorData->x + (float)sensorData->y * sensorData->y);
+  if (sensorData->force != 0) sensorData->angle = atan2f((float)sensorData->y, (float)sensorData->x);
+}
+
 
 /**
    @name setSensorBoard
@@ -39,6 +39,21 @@
 /**** NAU7802 related signal shaping parameters */
 #define NAU_DIVIDER 120                 // divider for the NAU raw values
 
+/**** adaptive x/y filter (One-Euro filter) parameters */
+#define FILTER_FRACBITS          8      // fractional bits of the filter state
+#define FILTER_CUTOFF_PER_US     2699   // 2*pi*1us*0.1Hz in Q32 (cutoff frequencies are given in 0.1 Hz)
+#define FILTER_MIN_INTERVAL      1000   // limits for the measured update interval (microseconds)
+#define FILTER_MAX_INTERVAL      50000
+#define FILTER_DERIVATE_CUTOFF   10     // cutoff frequency for the speed estimation (in 0.1 Hz)
+#define FILTER_BETA_DIVIDER      16     // divider for speed (units per UPDATE_INTERVAL) * beta
+#define FILTER_MAX_CUTOFF        5000   // upper limit for the adaptive cutoff frequency (in 0.1 Hz)
+
+/**** tremor filter (notch / bandstop biquad) parameters */
+#define TREMOR_COEFF_BITS        14     // fractional bits of the biquad coefficients
+#define TREMOR_MIN_WIDTH         5      // minimum bandwidth (in 0.1 Hz)
+#define TREMOR_RATE_TOLERANCE    16     // recalculate coefficients if the sampling interval changes by more than 1/16
+#define TREMOR_GAP_COUNT         8      // this many long intervals in a row are a new sampling rate (not a gap)
+
 /**** general sensor related settings */
 #define SENSOR_WATCHDOG_TIMEOUT 3000    // watchdog reset time (no NAU sensor data for x millsec. resets device)
 #define PRESSURE_SAMPLINGRATE   100        // sampling frequency of pressure sensor (MPRLS or DPS)
@@ -119,6 +134,13 @@ void calculateDirection(struct SensorData * sensorData);
 */
 void applyDeadzone(struct SensorData * sensorData, struct SlotSettings * slotSettings);
 
+/**
+   @name applySmoothing
+   @brief applies an adaptive lowpass filter (One-Euro filter) to the x/y values, cutoff frequency rises with movement speed
+   @return none
+*/
+void applySmoothing(struct SensorData * sensorData, struct SlotSettings * slotSettings);
+
 /**
    @name setSensorBoard
    @brief activates a certain parameters profile for signal processing, depending on the selected senosorboard ID
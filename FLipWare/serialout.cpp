@@ -0,0 +1,183 @@
+/*
+     FLipWare - AsTeRICS Foundation
+     For more info please visit: https://www.asterics-foundation.org
+
+     Module: serialout.cpp - buffered, non-blocking output to the serial interface
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; See the GNU General Public License:
+   http://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#include "serialout.h"
+
+SerialOutput SerialOut;
+struct SerialOutStatistics serialOutStatistics = {0};
+
+/**
+   static variables for output buffers
+*/
+uint8_t lineBuffer[SERIAL_LINE_LEN];
+uint16_t lineLen = 0;
+
+uint8_t replyBuffer[SERIAL_REPLY_BUFFER_SIZE];
+uint16_t replyHead = 0, replyCount = 0;
+
+// telemetry records are stored with a 1 byte length prefix
+uint8_t telemetryBuffer[SERIAL_TELEMETRY_BUFFER_SIZE];
+uint16_t telemetryHead = 0, telemetryCount = 0;
+uint8_t telemetryPartial = 0;   // bytes of the oldest telemetry record which were already sent
+
+SerialOutputProducer outputProducer = 0;
+
+/**
+   @name sendTelemetryRecord
+   @brief sends the oldest telemetry record (or the rest of a partly sent record)
+   @param space free space of the USB CDC endpoint, reduced by the sent bytes
+   @return 1 if the record was sent completely
+*/
+static uint8_t sendTelemetryRecord(int * space)
+{
+  uint8_t record[SERIAL_LINE_LEN];
+  uint16_t tail = (telemetryHead + SERIAL_TELEMETRY_BUFFER_SIZE - telemetryCount) % SERIAL_TELEMETRY_BUFFER_SIZE;
+  uint8_t len = telemetryBuffer[tail];
+  uint8_t rest = len - telemetryPartial;
+
+  if ((!telemetryPartial) && (*space < len)) return (0);   // records are only started if they fit
+  for (uint8_t i = 0; i < rest; i++)
+    record[i] = telemetryBuffer[(tail + 1 + telemetryPartial + i) % SERIAL_TELEMETRY_BUFFER_SIZE];
+  size_t sent = Serial.write(record, rest);
+  *space -= sent;
+  if (sent < rest) {
+    telemetryPartial += sent;
+    return (0);
+  }
+  telemetryPartial = 0;
+  telemetryCount -= len + 1;
+  return (1);
+}
+
+/**
+   @name drainSerialOutput
+   @brief sends buffered data while the USB CDC endpoint has space (replies first, then whole telemetry records)
+   @return none
+*/
+void drainSerialOutput()
+{
+  int space = Serial.availableForWrite();
+
+  // the rest of a partly sent telemetry record first, so that no reply is sent in the middle of the record
+  if (telemetryPartial && !sendTelemetryRecord(&space)) return;
+
+  // replies: contiguous chunks from the ring buffer
+  while (replyCount && (space > 0)) {
+    uint16_t tail = (replyHead + SERIAL_REPLY_BUFFER_SIZE - replyCount) % SERIAL_REPLY_BUFFER_SIZE;
+    int len = SERIAL_REPLY_BUFFER_SIZE - tail;
+    if (len > replyCount) len = replyCount;
+    if (len > space) len = space;
+    len = Serial.write(replyBuffer + tail, len);
+    if (!len) return;
+    replyCount -= len;
+    space -= len;
+  }
+  if (replyCount) return;
+
+  // telemetry: only complete records
+  while (telemetryCount && sendTelemetryRecord(&space));
+}
+
+/**
+   @name commitLine
+   @brief passes the collected line to the reply buffer. If the reply buffer is full (host does not read),
+          the line is discarded: the main loop never waits for the host. Long outputs use an output
+          producer (see setSerialOutputProducer), which only prints if there is space.
+   @return none
+*/
+void commitLine()
+{
+  if (SERIAL_REPLY_BUFFER_SIZE - replyCount < lineLen) drainSerialOutput();
+  if (SERIAL_REPLY_BUFFER_SIZE - replyCount < lineLen) {
+    serialOutStatistics.replyDiscarded += lineLen;
+    lineLen = 0;
+    return;
+  }
+  for (uint16_t i = 0; i < lineLen; i++) {
+    replyBuffer[replyHead] = lineBuffer[i];
+    replyHead = (replyHead + 1) % SERIAL_REPLY_BUFFER_SIZE;
+  }
+  replyCount += lineLen;
+  lineLen = 0;
+}
+
+size_t SerialOutput::write(uint8_t c)
+{
+  lineBuffer[lineLen++] = c;
+  if ((c == '\n') || (lineLen == SERIAL_LINE_LEN))
+    commitLine();
+  return (1);
+}
+
+size_t SerialOutput::write(const uint8_t * buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+    write(buffer[i]);
+  return (size);
+}
+
+void SerialOutput::flush()
+{
+  if (lineLen) commitLine();
+}
+
+void queueTelemetry(const uint8_t * data, uint16_t len)
+{
+  if (len > SERIAL_LINE_LEN) return;
+
+  // drop the oldest records until the new record fits (a partly sent record must be completed: drop the new one)
+  while (SERIAL_TELEMETRY_BUFFER_SIZE - telemetryCount < len + 1) {
+    if (telemetryPartial) {
+      serialOutStatistics.telemetryDropped += len;
+      return;
+    }
+    uint16_t tail = (telemetryHead + SERIAL_TELEMETRY_BUFFER_SIZE - telemetryCount) % SERIAL_TELEMETRY_BUFFER_SIZE;
+    uint8_t dropLen = telemetryBuffer[tail];
+    telemetryCount -= dropLen + 1;
+    serialOutStatistics.telemetryDropped += dropLen;
+  }
+
+  telemetryBuffer[telemetryHead] = len;
+  telemetryHead = (telemetryHead + 1) % SERIAL_TELEMETRY_BUFFER_SIZE;
+  for (uint16_t i = 0; i < len; i++) {
+    telemetryBuffer[telemetryHead] = data[i];
+    telemetryHead = (telemetryHead + 1) % SERIAL_TELEMETRY_BUFFER_SIZE;
+  }
+  telemetryCount += len + 1;
+}
+
+void setSerialOutputProducer(SerialOutputProducer producer)
+{
+  outputProducer = producer;
+}
+
+uint8_t serialOutputBusy()
+{
+  return (outputProducer != 0);
+}
+
+void serviceSerialOutput()
+{
+  // output of the last command / update is complete: pass incomplete lines (e.g. binary frames) too
+  if (lineLen) commitLine();
+  drainSerialOutput();
+
+  // long outputs: next lines as far as the reply buffer has space
+  while (outputProducer && (SERIAL_REPLY_BUFFER_SIZE - replyCount >= SERIAL_PRODUCER_SPACE)) {
+    if (!outputProducer()) outputProducer = 0;
+    if (lineLen) commitLine();
+  }
+  drainSerialOutput();
+}
@@ -0,0 +1,100 @@
+/*
+     FLipWare - AsTeRICS Foundation
+     For more info please visit: https://www.asterics-foundation.org
+
+     Module: serialout.h - buffered, non-blocking output to the serial interface, header file
+
+   All text output of core0 (AT replies, reports, messages) is written to SerialOut, which collects
+   complete lines and passes them to a reply buffer. Value reports are queued separately as telemetry
+   records. Both buffers are sent by serviceSerialOutput() when the USB CDC endpoint has space, so a slow
+   host does not block the main loop.
+
+   Reply data is never dropped (if the reply buffer is full, writing waits until space is available).
+   Telemetry records are complete lines / frames; if the telemetry buffer is full, the oldest records are dropped.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; See the GNU General Public License:
+   http://www.gnu.org/licenses/gpl-3.0.en.html
+*/
+
+#ifndef _SERIALOUT_H_
+#define _SERIALOUT_H_
+
+#include <Arduino.h>
+
+#define SERIAL_REPLY_BUFFER_SIZE      2048  // buffer for AT replies and messages (bytes)
+#define SERIAL_TELEMETRY_BUFFER_SIZE  1024  // buffer for telemetry records (bytes)
+#define SERIAL_LINE_LEN               128   // maximum length of a line / telemetry record
+#define SERIAL_PRODUCER_SPACE         512   // free reply buffer space before an output producer prints its next line
+
+/**
+   SerialOutStatistics struct
+   counts data which could not be sent (for AT ST)
+*/
+struct SerialOutStatistics {
+  uint32_t telemetryDropped;   // telemetry bytes dropped because the telemetry buffer was full
+  uint32_t replyDiscarded;     // reply bytes discarded because the reply buffer was full (host not reading)
+};
+
+/**
+   function which prints one line of a long output (e.g. AT LA) per call, returns 0 when the output is complete
+*/
+typedef uint8_t (*SerialOutputProducer)();
+
+/**
+   SerialOutput class
+   Print implementation which collects output lines and passes them to the reply buffer
+*/
+class SerialOutput : public Print {
+  public:
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t * buffer, size_t size);
+    virtual void flush();   // passes an incomplete line to the reply buffer
+    using Print::write;
+};
+
+/**
+   extern declaration of static variables
+   which shall be accessed from other modules
+*/
+extern SerialOutput SerialOut;
+extern struct SerialOutStatistics serialOutStatistics;
+
+/**
+   @name queueTelemetry
+   @brief queues a telemetry record (e.g. a report line or a stream frame), drops the oldest records if necessary
+   @param data pointer to the record
+   @param len length of the record (max. SERIAL_LINE_LEN)
+   @return none
+*/
+void queueTelemetry(const uint8_t * data, uint16_t len);
+
+/**
+   @name setSerialOutputProducer
+   @brief starts a long output (e.g. AT LA): the producer is called from serviceSerialOutput whenever the reply
+          buffer has space for another line, so the main loop never waits for the host
+   @param producer function which prints the next line
+   @return none
+*/
+void setSerialOutputProducer(SerialOutputProducer producer);
+
+/**
+   @name serialOutputBusy
+   @brief checks if a long output is in progress (serial commands are not processed meanwhile, so replies keep their order)
+   @return 1 if an output producer is active
+*/
+uint8_t serialOutputBusy();
+
+/**
+   @name serviceSerialOutput
+   @brief sends buffered replies and telemetry records as far as the USB CDC endpoint has space.
+          Replies have priority, telemetry records are only sent as a whole. Called frequently from loop().
+   @return none
+*/
+void serviceSerialOutput();
+
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+#include <Wire.h>
+
+enum {NAU7802_3V0, NAU7802_GAIN_128, NAU7802_RATE_320SPS, NAU7802_CAP_OFF, NAU7802_CALMOD_INTERNAL, NAU7802_CHANNEL1, NAU7802_CHANNEL2};
+
+class Adafruit_NAU7802 {
+  public:
+    bool begin(TwoWire *) { return false; }
+    void setLDO(int) {}
+    void setGain(int) {}
+    void setRate(int) {}
+    void setPGACap(int) {}
+    bool calibrate(int) { return true; }
+    bool available() { return false; }
+    int32_t read() { return 0; }
+    void setChannel(int) {}
+};
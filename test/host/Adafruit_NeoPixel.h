@@ -0,0 +1,13 @@
+#pragma once
+#include <Arduino.h>
+#define NEO_GRB 1
+#define NEO_KHZ800 2
+
+class Adafruit_NeoPixel {
+  public:
+    Adafruit_NeoPixel(int, int, int) {}
+    void begin() {}
+    void setBrightness(int) {}
+    void setPixelColor(int, int, int, int) {}
+    void show() {}
+};
@@ -0,0 +1,194 @@
+/*
+   Minimal host stand-in for the Arduino / arduino-pico API used by FLipWare.
+   Only declarations the firmware needs are provided, implementations are in arduino_host.cpp.
+   Test hooks (fake clock, captured serial / HID output) are declared in host.h.
+*/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>   // before the min / max macros below
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define PI 3.1415926535897932384626433832795
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_byte_near(p) (*(const uint8_t*)(p))
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 3
+#define A0 26
+#define A3 29
+#define DEC 10
+#define HEX 16
+#define digitalPinToInterrupt(x) x
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(int pin, int mode);
+int digitalRead(int pin);
+void digitalWrite(int pin, int value);
+int analogRead(int pin);
+void analogWriteFreq(int freq);
+void analogWriteRange(int range);
+void analogWrite(int pin, int value);
+void tone(int pin, int freq, int duration);
+void noTone(int pin);
+void attachInterrupt(int irq, void (*handler)(), int mode);
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+template<class T, class L, class H> auto constrain(const T& a, const L& b, const H& c) -> decltype(a < b ? (b < c ? b : c) : a)
+{
+  return a < b ? b : (a > c ? c : a);
+}
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+int toLowerCase(int c);
+
+class String {
+  public:
+    String(const char *s = "") : s(s) {}
+    String(int v) : s(std::to_string(v)) {}
+    String operator+(const String &o) const { return String((s + o.s).c_str()); }
+    void trim();
+    const char * c_str() const { return s.c_str(); }
+    bool equals(const char *o) const { return s == o; }
+    unsigned length() const { return s.length(); }
+    String substring(unsigned from) const { return String(from < s.length() ? s.c_str() + from : ""); }
+  private:
+    std::string s;
+};
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *b, size_t n) { size_t r = 0; while (n--) r += write(*b++); return r; }
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t write(const char *s, size_t n) { return write((const uint8_t *)s, n); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char *s);
+    size_t print(const String &s);
+    size_t print(char c);
+    size_t print(int v, int base = DEC);
+    size_t print(unsigned v, int base = DEC);
+    size_t print(long v, int base = DEC);
+    size_t print(unsigned long v, int base = DEC);
+    size_t print(double v, int digits = 2);
+    size_t println(const char *s);
+    size_t println(const String &s);
+    size_t println(char c);
+    size_t println(int v, int base = DEC);
+    size_t println(unsigned v, int base = DEC);
+    size_t println(long v, int base = DEC);
+    size_t println(unsigned long v, int base = DEC);
+    size_t println(double v, int digits = 2);
+    size_t println();
+    size_t printf(const char *format, ...);
+};
+
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    String readStringUntil(char terminator);
+    String readString();
+    size_t readBytes(char *buffer, size_t len);
+    size_t readBytes(uint8_t *buffer, size_t len) { return readBytes((char *)buffer, len); }
+    void setTimeout(unsigned long) {}
+};
+
+/**
+   serial port with captured output and injectable input (see host.h)
+*/
+class SerialUSB_ : public Stream {
+  public:
+    void begin(unsigned long baud) { baudrate = baud; }
+    void end() {}
+    int available() { return (int)(input.size() - inputPos); }
+    int read();
+    int peek();
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *b, size_t n);
+    using Print::write;
+    int availableForWrite();
+    void flush() {}
+    operator bool() { return true; }
+    bool ignoreFlowControl(bool = true) { return true; }
+
+    std::string input, output;
+    size_t inputPos = 0;
+    int writeSpace = 256;        // free space of the endpoint buffer
+    unsigned readRate = 0;       // bytes per second the host reads (0: unlimited)
+    size_t writeChunk = 0;       // maximum bytes accepted by one write call (0: unlimited)
+    unsigned long baudrate = 0;
+
+  private:
+    int credit = 0;              // readRate: bytes the host has read since the buffer was full
+    uint64_t creditTime = 0;
+};
+
+class SerialUART : public SerialUSB_ {
+  public:
+    void begin(unsigned long baud, uint16_t = 0) { baudrate = baud; }
+    bool setFIFOSize(size_t) { return true; }
+    bool setPollingMode(bool = true) { return true; }
+};
+
+extern SerialUSB_ Serial;
+extern SerialUART Serial1, Serial2;
+
+struct mutex_t { int locked; };
+void mutex_init(mutex_t *m);
+void mutex_enter_blocking(mutex_t *m);
+void mutex_exit(mutex_t *m);
+bool mutex_try_enter(mutex_t *m, uint32_t *owner);
+#define auto_init_mutex(n) mutex_t n
+
+class CoreMutex {
+  public:
+    CoreMutex(mutex_t *) {}
+    operator bool() { return true; }
+};
+
+struct Fifo {
+  bool push_nb(uint32_t v);
+  void push(uint32_t v);
+  uint32_t pop();
+  bool pop_nb(uint32_t *v);
+  int available();
+};
+struct RP2040_ {
+  Fifo fifo;
+  uint32_t getCycleCount();
+};
+extern RP2040_ rp2040;
+
+typedef int32_t alarm_id_t;
+struct alarm_pool_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t, void *);
+alarm_pool_t * alarm_pool_create(int num, int max);
+void alarm_pool_init_default();
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *data, bool fireIfPast);
+alarm_id_t alarm_pool_add_alarm_in_us(alarm_pool_t *pool, uint64_t us, alarm_callback_t callback, void *data, bool fireIfPast);
+bool cancel_alarm(alarm_id_t id);
+
+#define __arm__ 1
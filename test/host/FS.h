@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+#include <string>
+
+/**
+   file of the in-memory flash file system (see host.h, HostState::files)
+*/
+class File : public Stream {
+  public:
+    File() {}
+    File(std::string *data, const std::string &name) : data(data), name(name) {}
+    operator bool() const { return data != nullptr; }
+    int available() { return data ? (int)(data->size() - pos) : 0; }
+    int read() { return (data && (pos < data->size())) ? (uint8_t)(*data)[pos++] : -1; }
+    int peek() { return (data && (pos < data->size())) ? (uint8_t)(*data)[pos] : -1; }
+    size_t write(uint8_t c) { if (!data) return 0; data->push_back((char)c); return 1; }
+    size_t write(const uint8_t *b, size_t n) { if (!data) return 0; data->append((const char *)b, n); return n; }
+    using Print::write;
+    void close() { data = nullptr; }
+    size_t size() { return data ? data->size() : 0; }
+    size_t position() { return pos; }
+    bool seek(size_t p) { if (!data || (p > data->size())) return false; pos = p; return true; }
+    const char * fullName() { return name.c_str(); }
+
+  private:
+    std::string *data = nullptr;
+    std::string name;
+    size_t pos = 0;
+};
+
+/**
+   directory listing (files directly in the directory, in name order)
+*/
+class Dir {
+  public:
+    Dir() {}
+    Dir(const std::string &path) : path(path) { if (this->path.empty() || (this->path.back() != '/')) this->path += '/'; }
+    bool next();
+    size_t fileSize();
+    File openFile(const char *mode);
+    String fileName() { return String(current.substr(path.size()).c_str()); }
+
+  private:
+    std::string path, current;
+};
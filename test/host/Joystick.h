@@ -0,0 +1,29 @@
+#pragma once
+#include <Arduino.h>
+
+/**
+   keeps the joystick report state and counts sent reports (see host.h)
+*/
+class HID_Joystick {
+  public:
+    void begin() {}
+    void button(uint8_t num, bool pressed);
+    void X(int v) { axes[0] = v; }
+    void Y(int v) { axes[1] = v; }
+    void Z(int v) { axes[2] = v; }
+    void Zrotate(int v) { axes[3] = v; }
+    void sliderLeft(int v) { axes[4] = v; }
+    void sliderRight(int v) { axes[5] = v; }
+    void hat(int v) { hatValue = v; }
+    void use8bit(bool) { bits = 8; }
+    void use10bit() { bits = 10; }
+    void use16bit() { bits = 16; }
+    void useManualSend(bool) {}
+    void send_now();
+
+    int axes[6] = {0};
+    uint32_t buttons = 0;
+    int hatValue = -1;
+    int bits = 10;
+};
+extern HID_Joystick Joystick;
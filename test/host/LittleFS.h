@@ -0,0 +1,17 @@
+#pragma once
+#include <FS.h>
+
+/**
+   in-memory flash file system: the files are kept in HostState::files (see host.h)
+*/
+struct LittleFS_ {
+  bool begin() { return true; }
+  File open(const char *path, const char *mode);
+  Dir openDir(const char *path) { return Dir(path); }
+  bool exists(const char *path);
+  bool remove(const char *path);
+  bool remove(const String &path) { return remove(path.c_str()); }
+  bool rename(const char *from, const char *to);
+  bool mkdir(const char *) { return true; }
+};
+extern LittleFS_ LittleFS;
@@ -0,0 +1,20 @@
+#pragma once
+#include <Arduino.h>
+#define MOUSE_LEFT 1
+#define MOUSE_RIGHT 2
+#define MOUSE_MIDDLE 4
+
+/**
+   records every USB mouse report (see host.h)
+*/
+class HID_Mouse {
+  public:
+    void begin() {}
+    void move(int x, int y, signed char wheel = 0);
+    void press(uint8_t b = MOUSE_LEFT);
+    void release(uint8_t b = MOUSE_LEFT);
+    bool isPressed(uint8_t b = MOUSE_LEFT) { return (buttons & b) != 0; }
+
+    uint8_t buttons = 0;
+};
+extern HID_Mouse Mouse;
@@ -0,0 +1,22 @@
+#pragma once
+#include <Arduino.h>
+
+struct DevType {};
+extern const DevType Adafruit128x32, Adafruit128x64;
+extern const uint8_t System5x7[], Adafruit5x7[], Callibri11[], lcd5x7[];
+
+// display output is discarded
+class SSD1306Ascii : public Print {
+  public:
+    size_t write(uint8_t) { return 1; }
+    using Print::write;
+    void setFont(const uint8_t *) {}
+    void clear() {}
+    void set1X() {}
+    void set2X() {}
+    void setCursor(int, int) {}
+    void setInvertMode(bool) {}
+    void displayRemap(bool) {}
+    void setContrast(uint8_t) {}
+    void clearToEOL() {}
+};
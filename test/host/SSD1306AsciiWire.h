@@ -0,0 +1,9 @@
+#pragma once
+#include "SSD1306Ascii.h"
+#include <Wire.h>
+
+class SSD1306AsciiWire : public SSD1306Ascii {
+  public:
+    SSD1306AsciiWire(TwoWire &) {}
+    void begin(const DevType *, uint8_t) {}
+};
@@ -0,0 +1,326 @@
+/*
+   Host implementation of the Arduino / arduino-pico stand-ins (see Arduino.h and host.h)
+*/
+#include "host.h"
+#include <stdarg.h>
+#include <deque>
+#include <Mouse.h>
+#include <Keyboard.h>
+#include <Joystick.h>
+#include <LittleFS.h>
+#include <SSD1306Ascii.h>
+#include <Wire.h>
+#include <hardware/dma.h>
+#include <hardware/uart.h>
+
+HostState host = { 0, true, true, 0, 0, {}, {}, 0, {} };
+
+SerialUSB_ Serial;
+SerialUART Serial1, Serial2;
+RP2040_ rp2040;
+HID_Mouse Mouse;
+HID_Keyboard Keyboard;
+HID_Joystick Joystick;
+TwoWire Wire, Wire1;
+LittleFS_ LittleFS;
+
+const uint8_t KeyboardLayout_de_DE[128] = {0}, KeyboardLayout_en_US[128] = {0}, KeyboardLayout_es_ES[128] = {0},
+              KeyboardLayout_fr_FR[128] = {0}, KeyboardLayout_it_IT[128] = {0}, KeyboardLayout_sv_SE[128] = {0},
+              KeyboardLayout_da_DK[128] = {0};
+const DevType Adafruit128x32, Adafruit128x64;
+const uint8_t System5x7[1] = {0}, Adafruit5x7[1] = {0}, Callibri11[1] = {0}, lcd5x7[1] = {0};
+
+static uart_hw_t uartHw[2];
+uart_inst_t *uart0 = (uart_inst_t *)&uartHw[0], *uart1 = (uart_inst_t *)&uartHw[1];
+static std::deque<uint32_t> fifoData;
+
+
+static std::string dmaData;   // running transfer to the BT addon UART (see dma_channel_transfer_from_buffer_now)
+static uint64_t dmaDone;
+static void finishDmaTransfer();
+
+
+/*
+   test hooks
+*/
+void hostAdvance(uint64_t us) { host.clock += us; }
+
+void hostReset()
+{
+  host.usbMounted = host.usbReady = true;
+  host.usbBusyUntil = 0;
+  host.mouseReports.clear();
+  host.keyEvents.clear();
+  host.joystickReports = 0;
+  Serial.input.clear(); Serial.inputPos = 0; Serial.output.clear();
+  Serial2.input.clear(); Serial2.inputPos = 0; Serial2.output.clear();
+  dmaData.clear();
+}
+
+void hostSerialInput(const std::string &data) { Serial.input.append(data); }
+void hostAuxInput(const std::string &data) { Serial2.input.append(data); }
+
+std::string hostSerialOutput()
+{
+  std::string out;
+  out.swap(Serial.output);
+  return (out);
+}
+
+std::string hostAuxOutput()
+{
+  finishDmaTransfer();
+  std::string out;
+  out.swap(Serial2.output);
+  return (out);
+}
+
+
+/*
+   time, gpio and misc functions
+*/
+unsigned long millis() { return (unsigned long)(host.clock / 1000); }
+unsigned long micros() { return (unsigned long)(uint32_t)host.clock; }
+void delay(unsigned long ms) { hostAdvance((uint64_t)ms * 1000); }
+void delayMicroseconds(unsigned int us) { hostAdvance(us); }
+void yield() {}
+
+void pinMode(int, int) {}
+int digitalRead(int) { return HIGH; }   // buttons have pullups: not pressed
+void digitalWrite(int, int) {}
+int analogRead(int) { return 512; }
+void analogWriteFreq(int) {}
+void analogWriteRange(int) {}
+void analogWrite(int, int) {}
+void tone(int, int, int) {}
+void noTone(int) {}
+void attachInterrupt(int, void (*)(), int) {}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+int toLowerCase(int c) { return (c >= 'A' && c <= 'Z') ? c + 'a' - 'A' : c; }
+
+void String::trim()
+{
+  size_t first = s.find_first_not_of(" \t\r\n");
+  size_t last = s.find_last_not_of(" \t\r\n");
+  s = (first == std::string::npos) ? "" : s.substr(first, last - first + 1);
+}
+
+void mutex_init(mutex_t *m) { m->locked = 0; }
+void mutex_enter_blocking(mutex_t *m) { m->locked = 1; }
+void mutex_exit(mutex_t *m) { m->locked = 0; }
+bool mutex_try_enter(mutex_t *m, uint32_t *) { if (m->locked) return false; m->locked = 1; return true; }
+
+bool Fifo::push_nb(uint32_t v) { fifoData.push_back(v); return true; }
+void Fifo::push(uint32_t v) { fifoData.push_back(v); }
+uint32_t Fifo::pop() { uint32_t v = fifoData.front(); fifoData.pop_front(); return v; }
+bool Fifo::pop_nb(uint32_t *v) { if (fifoData.empty()) return false; *v = pop(); return true; }
+int Fifo::available() { return (int)fifoData.size(); }
+uint32_t RP2040_::getCycleCount() { return (uint32_t)(host.clock * 133); }
+
+// alarms are never fired (IR playback is not tested)
+alarm_pool_t * alarm_pool_create(int, int) { return nullptr; }
+void alarm_pool_init_default() {}
+alarm_id_t add_alarm_in_us(uint64_t, alarm_callback_t, void *, bool) { return 1; }
+alarm_id_t alarm_pool_add_alarm_in_us(alarm_pool_t *, uint64_t, alarm_callback_t, void *, bool) { return 1; }
+bool cancel_alarm(alarm_id_t) { return true; }
+
+
+/*
+   print / stream
+*/
+size_t Print::print(const char *s) { return write(s); }
+size_t Print::print(const String &s) { return write(s.c_str()); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(int v, int base) { return print((long)v, base); }
+size_t Print::print(unsigned v, int base) { return print((unsigned long)v, base); }
+
+size_t Print::print(long v, int base)
+{
+  if ((base == DEC) || (v >= 0)) return printf(base == DEC ? "%ld" : "%lX", v);
+  return print((unsigned long)v, base);
+}
+
+size_t Print::print(unsigned long v, int base) { return printf(base == HEX ? "%lX" : "%lu", v); }
+size_t Print::print(double v, int digits) { return printf("%.*f", digits, v); }
+
+size_t Print::println(const char *s) { return print(s) + println(); }
+size_t Print::println(const String &s) { return print(s) + println(); }
+size_t Print::println(char c) { return print(c) + println(); }
+size_t Print::println(int v, int base) { return print(v, base) + println(); }
+size_t Print::println(unsigned v, int base) { return print(v, base) + println(); }
+size_t Print::println(long v, int base) { return print(v, base) + println(); }
+size_t Print::println(unsigned long v, int base) { return print(v, base) + println(); }
+size_t Print::println(double v, int digits) { return print(v, digits) + println(); }
+size_t Print::println() { return write("\r\n"); }
+
+size_t Print::printf(const char *format, ...)
+{
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  return write((const uint8_t *)buf, (size_t)len < sizeof(buf) ? len : sizeof(buf) - 1);
+}
+
+String Stream::readStringUntil(char terminator)
+{
+  std::string s;
+  int c;
+  while (((c = read()) >= 0) && (c != terminator)) s.push_back((char)c);
+  return String(s.c_str());
+}
+
+String Stream::readString() { return readStringUntil(0); }
+
+size_t Stream::readBytes(char *buffer, size_t len)
+{
+  size_t n = 0;
+  int c;
+  while ((n < len) && ((c = read()) >= 0)) buffer[n++] = (char)c;
+  return n;
+}
+
+int SerialUSB_::availableForWrite()
+{
+  if (!readRate) return writeSpace;
+  uint64_t bytes = (host.clock - creditTime) * readRate / 1000000;
+  creditTime += bytes * 1000000 / readRate;
+  credit = (int)std::min<uint64_t>(credit + bytes, writeSpace);
+  if (credit == writeSpace) creditTime = host.clock;
+  return credit;
+}
+
+size_t SerialUSB_::write(const uint8_t *b, size_t n)
+{
+  if (writeChunk && (n > writeChunk)) n = writeChunk;
+  if (readRate) {
+    n = std::min<size_t>(n, availableForWrite());
+    credit -= (int)n;
+  }
+  output.append((const char *)b, n);
+  return n;
+}
+
+int SerialUSB_::read() { return (inputPos < input.size()) ? (uint8_t)input[inputPos++] : -1; }
+int SerialUSB_::peek() { return (inputPos < input.size()) ? (uint8_t)input[inputPos] : -1; }
+
+
+/*
+   BT addon UART: a DMA transfer takes the wire time at the current baud rate (10 bits per byte),
+   the data arrives in Serial2 when the transfer is finished. Polling a busy channel takes 1 us.
+*/
+static void finishDmaTransfer()
+{
+  if (dmaData.empty() || (host.clock < dmaDone)) return;
+  Serial2.write((const uint8_t *)dmaData.data(), dmaData.size());
+  dmaData.clear();
+}
+
+uart_hw_t * uart_get_hw(uart_inst_t *uart) { return (uart_hw_t *)uart; }
+int dma_claim_unused_channel(bool) { return 0; }
+dma_channel_config dma_channel_get_default_config(int channel) { return dma_channel_config{channel}; }
+
+bool dma_channel_is_busy(int)
+{
+  finishDmaTransfer();
+  if (dmaData.empty()) return (false);
+  host.clock++;
+  return (true);
+}
+
+void dma_channel_transfer_from_buffer_now(int, const volatile void *buffer, uint32_t len)
+{
+  finishDmaTransfer();
+  dmaData.append((const char *)buffer, len);
+  dmaDone = host.clock + (Serial2.baudrate ? (uint64_t)len * 10000000 / Serial2.baudrate : 0);
+}
+
+void dma_channel_abort(int) { dmaData.clear(); }
+
+
+/*
+   flash file system (in memory, see host.h)
+*/
+File LittleFS_::open(const char *path, const char *mode)
+{
+  if (mode[0] == 'r') {
+    auto it = host.files.find(path);
+    return (it == host.files.end() ? File() : File(&it->second, path));
+  }
+  std::string &data = host.files[path];
+  if (mode[0] == 'w') data.clear();
+  return (File(&data, path));
+}
+
+bool LittleFS_::exists(const char *path)
+{
+  std::string dir = std::string(path) + "/";
+  if (host.files.count(path)) return true;
+  auto it = host.files.lower_bound(dir);
+  return ((it != host.files.end()) && (it->first.compare(0, dir.size(), dir) == 0));
+}
+
+bool LittleFS_::remove(const char *path) { return (host.files.erase(path) > 0); }
+
+bool LittleFS_::rename(const char *from, const char *to)
+{
+  auto it = host.files.find(from);
+  if (it == host.files.end()) return false;
+  std::string data = it->second;
+  host.files.erase(it);
+  host.files[to] = data;
+  return true;
+}
+
+bool Dir::next()
+{
+  for (auto it = host.files.upper_bound(current.empty() ? path : current); it != host.files.end(); ++it) {
+    if (it->first.compare(0, path.size(), path) != 0) break;
+    if (it->first.find('/', path.size()) != std::string::npos) continue;   // file in a subdirectory
+    current = it->first;
+    return true;
+  }
+  return false;
+}
+
+size_t Dir::fileSize()
+{
+  auto it = host.files.find(current);
+  return (it == host.files.end() ? 0 : it->second.size());
+}
+
+File Dir::openFile(const char *mode) { return LittleFS.open(current.c_str(), mode); }
+
+
+/*
+   USB HID
+*/
+bool tud_hid_ready(void) { return host.usbMounted && host.usbReady && (host.clock >= host.usbBusyUntil); }
+bool tud_mounted(void) { return host.usbMounted; }
+
+// every report occupies the endpoint until the next poll of the USB host
+static void usbReport() { host.usbBusyUntil = host.clock + host.usbInterval; }
+
+void HID_Mouse::move(int x, int y, signed char wheel) { host.mouseReports.push_back({x, y, wheel, micros()}); usbReport(); }
+void HID_Mouse::press(uint8_t b) { buttons |= b; usbReport(); }
+void HID_Mouse::release(uint8_t b) { buttons &= ~b; usbReport(); }
+
+size_t HID_Keyboard::write(uint8_t c) { press(c); release(c); return 1; }
+size_t HID_Keyboard::press(uint8_t k) { host.keyEvents.push_back({k, true, micros()}); usbReport(); return 1; }
+size_t HID_Keyboard::release(uint8_t k) { host.keyEvents.push_back({k, false, micros()}); usbReport(); return 1; }
+void HID_Keyboard::releaseAll() { host.keyEvents.push_back({0, false, micros()}); usbReport(); }
+
+void HID_Joystick::button(uint8_t num, bool pressed)
+{
+  if ((num < 1) || (num > 32)) return;
+  if (pressed) buttons |= 1UL << (num - 1);
+  else buttons &= ~(1UL << (num - 1));
+}
+void HID_Joystick::send_now() { host.joystickReports++; usbReport(); }
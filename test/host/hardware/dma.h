@@ -0,0 +1,17 @@
+#pragma once
+#include <stdint.h>
+
+// DMA stand-in: a transfer takes the UART wire time, then the buffer arrives in Serial2 (see arduino_host.cpp)
+typedef struct { int channel; } dma_channel_config;
+#define DMA_SIZE_8 0
+
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(int channel);
+inline void channel_config_set_transfer_data_size(dma_channel_config *, int) {}
+inline void channel_config_set_read_increment(dma_channel_config *, bool) {}
+inline void channel_config_set_write_increment(dma_channel_config *, bool) {}
+inline void channel_config_set_dreq(dma_channel_config *, int) {}
+inline void dma_channel_configure(int, const dma_channel_config *, volatile void *, const volatile void *, uint32_t, bool) {}
+bool dma_channel_is_busy(int channel);
+void dma_channel_transfer_from_buffer_now(int channel, const volatile void *buffer, uint32_t len);
+void dma_channel_abort(int channel);
@@ -0,0 +1,8 @@
+#pragma once
+#include <stdint.h>
+
+typedef struct { volatile uint32_t dr; volatile uint32_t fr; } uart_hw_t;
+typedef struct uart_inst uart_inst_t;
+extern uart_inst_t *uart0, *uart1;
+uart_hw_t * uart_get_hw(uart_inst_t *uart);
+inline int uart_get_dreq(uart_inst_t *, bool) { return 0; }
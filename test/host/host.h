@@ -0,0 +1,60 @@
+/*
+   Test hooks of the host build: fake clock, serial / BT addon data and recorded HID reports.
+*/
+#pragma once
+#include <Arduino.h>
+#include <vector>
+#include <map>
+#include <string>
+
+struct HostMouseReport {
+  int x, y, wheel;
+  unsigned long time;    // micros() when the report was sent
+};
+
+struct HostKeyEvent {
+  uint8_t key;           // 0 for releaseAll
+  bool pressed;
+  unsigned long time;
+};
+
+struct HostState {
+  uint64_t clock;                     // microseconds since start
+  bool usbMounted, usbReady;          // tud_mounted() / tud_hid_ready()
+  unsigned usbInterval;               // HID endpoint busy after a report (microseconds, 0: always ready)
+  uint64_t usbBusyUntil;
+  std::vector<HostMouseReport> mouseReports;
+  std::vector<HostKeyEvent> keyEvents;
+  unsigned joystickReports;
+  std::map<std::string, std::string> files;   // flash file system: path -> content (kept by hostReset)
+};
+extern HostState host;
+
+/**
+   @name hostAdvance
+   @brief advances the fake clock (delay() and delayMicroseconds() do the same)
+   @param us: microseconds
+   @return none
+*/
+void hostAdvance(uint64_t us);
+
+/**
+   @name hostReset
+   @brief clears recorded reports and serial data, USB is mounted and ready afterwards
+   @return none
+*/
+void hostReset();
+
+/**
+   @name hostSerialInput / hostAuxInput
+   @brief injects data which will be read from Serial (host) or Serial2 (BT addon)
+*/
+void hostSerialInput(const std::string &data);
+void hostAuxInput(const std::string &data);
+
+/**
+   @name hostSerialOutput / hostAuxOutput
+   @brief returns and clears the data written to Serial (host) or Serial2 (BT addon)
+*/
+std::string hostSerialOutput();
+std::string hostAuxOutput();
@@ -0,0 +1,7 @@
+#pragma once
+#include <stdint.h>
+
+// USB device state, controlled by the tests (see host.h)
+bool tud_hid_ready(void);
+bool tud_mounted(void);
+inline void tud_task(void) {}
@@ -0,0 +1,175 @@
+/*
+   Stand-in for the ESP32 BT addon on Serial2: decodes the legacy and the framed (COBS / CRC16) protocol
+   independently of the firmware code, acknowledges frames, answers the protocol and baud rate negotiation
+   and records the received HID reports.
+*/
+#pragma once
+#include "host.h"
+#include <string>
+#include <vector>
+
+#define ADDON_DEFAULT_BAUDRATE  115200
+#define ADDON_LINKTEST_TIMEOUT  200   // ms: the addon returns to the default rate if the link test fails
+
+struct AddonFrame {
+  uint8_t type, seq, flags;
+  std::string payload;
+  unsigned long time;   // micros() when the frame was received
+};
+
+class BTAddon {
+  public:
+    bool framedCapable = true;                        // replies to "$FP" (otherwise: old addon)
+    std::vector<uint32_t> refusedRates, brokenRates;  // "BAUD:NO" / link test fails at these rates
+    uint32_t baudrate = ADDON_DEFAULT_BAUDRATE;
+    bool framed = false;
+    std::vector<AddonFrame> frames;       // all valid frames from the firmware
+    std::vector<std::string> legacy;      // legacy mode: text commands and raw 0xFD reports
+    std::vector<std::string> commands;    // "$" commands (both modes)
+    unsigned crcErrors = 0, garbled = 0;
+
+    /**
+       reads the data the firmware wrote to Serial2 and replies
+    */
+    void service()
+    {
+      std::string data = hostAuxOutput();
+      if (testStart && (millis() - testStart > ADDON_LINKTEST_TIMEOUT)) {   // link test failed: back to default
+        baudrate = ADDON_DEFAULT_BAUDRATE;
+        testStart = 0;
+      }
+      if (Serial2.baudrate != baudrate) {   // different baud rates: only garbage arrives
+        garbled += data.size();
+        return;
+      }
+      for (char c : data) framed ? receiveFramed((uint8_t)c) : receiveLegacy((uint8_t)c);
+    }
+
+    void sendStatus(const std::string & text)
+    {
+      if (framed) sendFrame(0x05, text);
+      else hostAuxInput(text + "\r\n");
+    }
+
+    /**
+       sends a frame to the firmware (type, own sequence number, flags 0, payload, CRC)
+    */
+    void sendFrame(uint8_t type, const std::string & payload, bool corrupt = false)
+    {
+      std::string frame;
+      frame.push_back((char)type);
+      frame.push_back((char)txSeq++);
+      frame.push_back(0);
+      frame += payload;
+      uint16_t crc = crc16(frame);
+      frame.push_back((char)(crc & 0xff));
+      frame.push_back((char)(crc >> 8));
+      if (corrupt) frame[3] ^= 0x40;
+      hostAuxInput(cobsEncode(frame) + std::string(1, '\0'));
+    }
+
+    static uint16_t crc16(const std::string & data)   // CRC-16/CCITT-FALSE
+    {
+      uint16_t crc = 0xffff;
+      for (unsigned char c : data) {
+        crc ^= (uint16_t)c << 8;
+        for (int i = 0; i < 8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+      }
+      return (crc);
+    }
+
+    static std::string cobsEncode(const std::string & in)
+    {
+      std::string out;
+      std::string block;
+      for (size_t i = 0; i <= in.size(); i++) {
+        if ((i == in.size()) || (in[i] == 0) || (block.size() == 254)) {
+          out.push_back((char)(block.size() + 1));
+          out += block;
+          block.clear();
+          if ((i < in.size()) && (in[i] != 0)) block.push_back(in[i]);   // full block: byte starts the next one
+        }
+        else block.push_back(in[i]);
+      }
+      return (out);
+    }
+
+    static bool cobsDecode(const std::string & in, std::string & out)
+    {
+      out.clear();
+      size_t i = 0;
+      while (i < in.size()) {
+        uint8_t code = (uint8_t)in[i++];
+        if (!code || (i + code - 1 > in.size())) return (false);
+        out.append(in, i, code - 1);
+        i += code - 1;
+        if ((code < 0xff) && (i < in.size())) out.push_back(0);
+      }
+      return (true);
+    }
+
+  private:
+    std::string rx;
+    uint8_t txSeq = 0;
+    unsigned long testStart = 0;
+
+    void receiveLegacy(uint8_t c)
+    {
+      if (rx.empty() && (c == 0xFD)) { rx.push_back(c); return; }
+      if (!rx.empty() && ((uint8_t)rx[0] == 0xFD)) {
+        rx.push_back(c);
+        // raw reports: keyboard 0xFD + 8 bytes, mouse 0xFD 0x00 0x03 + 6 bytes, joystick 0xFD 0x00 0x01 + 11 bytes
+        size_t len = (rx.size() >= 3) && (rx[1] == 0) && (rx[2] == 3) ? 9 : (rx.size() >= 3) && (rx[1] == 0) && (rx[2] == 1) ? 14 : 9;
+        if (rx.size() >= len) { legacy.push_back(rx); rx.clear(); }
+        return;
+      }
+      if (c == '\n') {
+        legacy.push_back(rx);
+        if (!rx.empty() && (rx[0] == '$')) command(rx);
+        rx.clear();
+      }
+      else rx.push_back(c);
+    }
+
+    void receiveFramed(uint8_t c)
+    {
+      if (c) { rx.push_back(c); return; }
+      std::string frame;
+      bool ok = cobsDecode(rx, frame) && (frame.size() >= 5);
+      rx.clear();
+      if (!ok || (crc16(frame.substr(0, frame.size() - 2)) != (uint8_t)frame[frame.size() - 2] + ((uint8_t)frame[frame.size() - 1] << 8))) {
+        crcErrors++;
+        return;
+      }
+      AddonFrame f = {(uint8_t)frame[0], (uint8_t)frame[1], (uint8_t)frame[2], frame.substr(3, frame.size() - 5), micros()};
+      frames.push_back(f);
+      if (f.flags & 0x01) sendFrame(0x06, std::string(1, (char)f.seq));   // acknowledge
+      if (f.type == 0x04) command(f.payload);
+    }
+
+    void command(const std::string & cmd)
+    {
+      commands.push_back(cmd);
+      if (cmd == "$FP") {
+        if (!framedCapable) return;
+        sendStatus("FRAMED:1");
+        framed = true;
+      }
+      else if (cmd.compare(0, 4, "$BD ") == 0) {
+        uint32_t rate = strtoul(cmd.c_str() + 4, nullptr, 10);
+        if (std::find(refusedRates.begin(), refusedRates.end(), rate) != refusedRates.end()) {
+          sendStatus("BAUD:NO");
+          return;
+        }
+        sendStatus("BAUD:OK");
+        baudrate = rate;
+        testStart = millis();
+        if (std::find(brokenRates.begin(), brokenRates.end(), rate) != brokenRates.end()) baudrate = 1;   // nothing arrives
+      }
+      else if (cmd.compare(0, 4, "$LT ") == 0) {
+        sendStatus("LINKTEST:" + cmd.substr(4));
+        testStart = 0;
+      }
+      else if (cmd == "$GC") sendStatus("CONNECTED:aa:bb:cc:dd:ee:ff");
+    }
+};
@@ -0,0 +1,65 @@
+/*
+   DMA transmit ring of the BT addon UART: throughput against the wire rate and core0 time per queued
+   command, and the baud rate during an addon firmware upgrade (AT UG): the passthrough rate is recorded
+   in btBaudrate, the default rate is restored afterwards.
+*/
+#include "FlipWare.h"
+#include "bluetooth.h"
+#include "host.h"
+#include "testutil.h"
+
+void setup();
+void loop();
+
+int main()
+{
+  setup();
+  for (int i = 0; i < 5; i++) loop();
+  hostReset();
+
+  // legacy addon at the default rate: a 40 byte command (with line end) every millisecond, more than the
+  // UART can send (11.5 kB/s); the ring stays full, commands which do not fit are rejected
+  btProtocol = BT_PROTOCOL_LEGACY;
+  hostAuxOutput();
+  const char * cmd = "$NM 0123456789012345678901234567890123";
+  uint32_t overflows = btStatistics.txOverflows;
+  uint64_t callTimeMax = 0, start = host.clock;
+  size_t received = 0;
+  for (int ms = 0; ms < 2000; ms++) {
+    uint64_t before = host.clock;
+    sendBTCommand(cmd);
+    if (host.clock - before > callTimeMax) callTimeMax = host.clock - before;
+    loop();
+    received += hostAuxOutput().size();
+  }
+  float seconds = (host.clock - start) / 1e6f;
+  float wireRate = BT_DEFAULT_BAUDRATE / 10.0f;
+  printf("DMA ring at %d baud: %.0f bytes/s (%.1f%% of the wire rate), %lu commands rejected, "
+         "max. %lu us per command\n", BT_DEFAULT_BAUDRATE, received / seconds, 100 * received / seconds / wireRate,
+         (unsigned long)(btStatistics.txOverflows - overflows), (unsigned long)callTimeMax);
+  CHECK(received / seconds > 0.95f * wireRate);
+  CHECK(btStatistics.txOverflows > overflows);
+  CHECK(callTimeMax < 10);   // no waiting for the UART
+  CHECK(btStatistics.txHighWater > AUX_TX_BUFFER_SIZE - (strlen(cmd) + 1));   // the ring is used completely
+
+  // addon upgrade: the passthrough runs at BT_UPGRADE_BAUDRATE, pending data is sent before the switch
+  hostAuxOutput();
+  hostSerialOutput();
+  hostSerialInput("AT UG\r\n");
+  for (int i = 0; i < 10; i++) loop();
+  std::string aux = hostAuxOutput();
+  CHECK(aux.find("$UG\n") != std::string::npos);
+  CHECK_EQ(Serial2.baudrate, BT_UPGRADE_BAUDRATE);
+  CHECK_EQ(btBaudrate, BT_UPGRADE_BAUDRATE);
+
+  // no upgrade data for 20 seconds: back to the default rate
+  for (int i = 0; i < 21000; i++) {
+    loop();
+    hostAdvance(1000);
+  }
+  loop();
+  CHECK_EQ(Serial2.baudrate, BT_DEFAULT_BAUDRATE);
+  CHECK_EQ(btBaudrate, BT_DEFAULT_BAUDRATE);
+
+  return (TEST_RESULT());
+}
@@ -0,0 +1,156 @@
+/*
+   Framed BT addon protocol (COBS / CRC16) against an ESP32 stand-in (btaddon.h):
+   legacy fallback, protocol and baud rate negotiation, report frames, acknowledges,
+   corrupted / overlong frames and random status frames.
+*/
+#include "FlipWare.h"
+#include "bluetooth.h"
+#include "binaryframes.h"
+#include "btaddon.h"
+#include "testutil.h"
+
+void setup();
+void loop();
+extern uint8_t btLinkState;
+
+static BTAddon * addon;
+
+static void run(int ms)
+{
+  for (int i = 0; i < ms; i++) {
+    loop();
+    addon->service();
+  }
+}
+
+/**
+   resets the firmware protocol state and restarts the negotiation with the given addon ("$FP" as in initBluetooth)
+*/
+static void connect(BTAddon & a)
+{
+  addon = &a;
+  btProtocol = BT_PROTOCOL_LEGACY;
+  btLinkState = 0;
+  Serial2.begin(BT_DEFAULT_BAUDRATE);
+  btBaudrate = BT_DEFAULT_BAUDRATE;
+  hostAuxOutput();
+  sendBTCommand("$FP");
+  run(2000);
+}
+
+int main()
+{
+  setup();
+  for (int i = 0; i < 5; i++) loop();
+  hostReset();
+
+  // the CRC is CRC-16/CCITT-FALSE (check value of "123456789")
+  CHECK_EQ(calculateCRC16((const uint8_t *)"123456789", 9), 0x29B1);
+
+  // old addon: no reply to $FP, reports stay in the legacy format
+  BTAddon old;
+  old.framedCapable = false;
+  connect(old);
+  CHECK_EQ(btProtocol, BT_PROTOCOL_LEGACY);
+  CHECK_EQ(Serial2.baudrate, BT_DEFAULT_BAUDRATE);
+  old.legacy.clear();
+  mouseBT(5, -3, 0);
+  run(50);
+  CHECK_EQ(old.legacy.size(), 1);
+  if (old.legacy.size() == 1) CHECK(old.legacy[0] == std::string("\xFD\x00\x03\x00\x05\xFD\x00\x00\x00", 9));
+
+  // legacy commands beyond the transmit ring: a command is sent completely (with its line end) or not at all
+  old.legacy.clear();
+  uint32_t overflows = btStatistics.txOverflows;
+  for (int i = 0; i < 100; i++) sendBTCommand(("$NM " + std::string(i % 13 + 1, 'a' + i % 26)).c_str());
+  run(500);
+  int broken = 0;
+  for (auto & line : old.legacy)
+    if ((line.compare(0, 4, "$NM ") != 0) || (line.find_first_not_of(line[4], 4) != std::string::npos)) broken++;
+  printf("100 legacy commands in a burst: %zu received, %lu rejected\n", old.legacy.size(),
+         (unsigned long)(btStatistics.txOverflows - overflows));
+  CHECK(btStatistics.txOverflows > overflows);
+  CHECK_EQ(old.legacy.size() + btStatistics.txOverflows - overflows, 100);
+  CHECK_EQ(broken, 0);
+
+  // new addon: framed protocol, fastest baud rate
+  BTAddon fast;
+  connect(fast);
+  CHECK_EQ(btProtocol, BT_PROTOCOL_FRAMED);
+  CHECK_EQ(btLinkState, 3);
+  CHECK_EQ(btBaudrate, 2000000);
+  CHECK_EQ(Serial2.baudrate, fast.baudrate);
+  printf("negotiated %lu baud, commands:", (unsigned long)btBaudrate);
+  for (auto & c : fast.commands) printf(" \"%s\"", c.c_str());
+  printf("\n");
+
+  // refused and broken rates: the next lower rate is used
+  BTAddon slow;
+  slow.refusedRates = {2000000};
+  slow.brokenRates = {1000000};
+  connect(slow);
+  CHECK_EQ(btBaudrate, 921600);
+  CHECK_EQ(slow.baudrate, 921600);
+  CHECK(slow.garbled > 0);   // the link test at 1000000 failed
+  printf("with refused / broken rates: %lu baud\n", (unsigned long)btBaudrate);
+
+  // reports are frames with increasing sequence numbers, commands are acknowledged
+  slow.frames.clear();
+  uint32_t requested = btStatistics.acksRequested, received = btStatistics.acksReceived;
+  mouseBT(300, 0, 0);       // three reports: 127 + 127 + 46
+  run(2100);
+  int mouseFrames = 0, sum = 0;
+  for (size_t i = 0; i < slow.frames.size(); i++) {
+    AddonFrame & f = slow.frames[i];
+    if (i) CHECK_EQ(f.seq, (uint8_t)(slow.frames[i - 1].seq + 1));
+    if (f.type == BT_MSG_MOUSE) {
+      mouseFrames++;
+      CHECK_EQ(f.payload.size(), 6);
+      sum += (int8_t)f.payload[1];
+    }
+  }
+  CHECK_EQ(mouseFrames, 3);
+  CHECK_EQ(sum, 300);
+  CHECK(btStatistics.acksRequested > requested);     // $GC polls
+  CHECK_EQ(btStatistics.acksReceived - received, btStatistics.acksRequested - requested);
+  CHECK_EQ(slow.crcErrors, 0);
+  CHECK(isBluetoothConnected());                     // "CONNECTED:<mac>" reply to $GC
+
+  // corrupted and overlong frames are counted and dropped
+  uint32_t errors = btStatistics.framingErrors;
+  hostSerialOutput();
+  slow.sendFrame(BT_MSG_STATUS, "corrupted", true);
+  hostAuxInput(std::string(100, 'x') + std::string(1, '\0'));
+  run(5);
+  CHECK_EQ(btStatistics.framingErrors, errors + 2);
+  CHECK(hostSerialOutput().find("corrupted") == std::string::npos);
+
+  // the tail of an overlong frame is not decoded as a frame of its own
+  hostAuxInput(std::string(BT_FRAME_MAX + 1, 'x'));
+  slow.sendFrame(BT_MSG_STATUS, "tail");
+  run(5);
+  CHECK_EQ(btStatistics.framingErrors, errors + 3);
+  CHECK(hostSerialOutput().find("tail") == std::string::npos);
+  slow.sendFrame(BT_MSG_STATUS, "next");   // the following frame is received
+  run(5);
+  CHECK(hostSerialOutput().find("next") != std::string::npos);
+
+  // random status frames (all byte values, also 0x00 and 0xFF) arrive unchanged
+  int mismatches = 0;
+  for (int i = 0; i < 500; i++) {
+    std::string text;
+    int len = abs(testNoise(27)) + 1;
+    for (int j = 0; j < len; j++) {
+      int c = testNoise(127) + 128;
+      text.push_back((char)((c == '\r') || (c == '\n') ? 0 : c));
+    }
+    slow.sendFrame(BT_MSG_STATUS, text);
+    run(1);
+    std::string out = hostSerialOutput();
+    if (out.find(text + "\r\n") == std::string::npos) mismatches++;
+  }
+  CHECK_EQ(mismatches, 0);
+  CHECK_EQ(btStatistics.framingErrors, errors + 3);
+
+  return (TEST_RESULT());
+}
@@ -0,0 +1,148 @@
+/*
+   Time-based BT mouse reports (AT BI): movement from mouseBT() is sent by the report scheduler on a fixed
+   cadence, saturated to +-127 per report with the remainder carried over, and flushed when the stick is idle.
+   The reports are decoded by the ESP32 stand-in (btaddon.h), the sum of all reports must equal the input.
+*/
+#include "FlipWare.h"
+#include "bluetooth.h"
+#include "btaddon.h"
+#include "testutil.h"
+
+void setup();
+void loop();
+extern int btAccuX, btAccuY, btAccuScroll;
+
+static BTAddon addon;
+
+static void run(int ms)
+{
+  for (int i = 0; i < ms; i++) {
+    loop();
+    addon.service();
+  }
+}
+
+struct MouseTotal {
+  int x, y, wheel, reports;
+  uint32_t minGap;   // smallest time between two mouse reports (microseconds)
+  uint32_t last;     // time of the last mouse report
+};
+
+static MouseTotal mouseFrames()
+{
+  MouseTotal t = {0, 0, 0, 0, UINT32_MAX, 0};
+  for (AddonFrame & f : addon.frames) {
+    if (f.type != BT_MSG_MOUSE) continue;
+    int8_t x = (int8_t)f.payload[1], y = (int8_t)f.payload[2], wheel = (int8_t)f.payload[3];
+    CHECK((x >= -127) && (y >= -127) && (wheel >= -127));
+    if (t.reports && (f.time - t.last < t.minGap)) t.minGap = f.time - t.last;
+    t.x += x;
+    t.y += y;
+    t.wheel += wheel;
+    t.last = f.time;
+    t.reports++;
+  }
+  addon.frames.clear();
+  return (t);
+}
+
+int main()
+{
+  setup();
+  for (int i = 0; i < 5; i++) loop();
+  hostReset();
+
+  // framed addon (as in test_btframing)
+  btProtocol = BT_PROTOCOL_LEGACY;
+  hostAuxOutput();
+  sendBTCommand("$FP");
+  run(2000);
+  CHECK_EQ(btProtocol, BT_PROTOCOL_FRAMED);
+  mouseFrames();
+
+  static const int intervals[] = {BT_MOUSE_INTERVAL_MIN, BT_MOUSE_INTERVAL_DEFAULT, 50};
+  for (int interval : intervals) {
+    hostSerialInput("AT BI " + std::to_string(interval) + "\r\n");
+    run(5);
+    CHECK_EQ(btMouseInterval, interval);
+
+    // stick movement every update (8 ms) for 2 seconds, partly beyond the report range
+    int sumX = 0, sumY = 0, sumWheel = 0;
+    for (int tick = 0; tick < 250; tick++) {
+      int x = testNoise(tick < 125 ? 20 : 400), y = testNoise(60);
+      uint8_t wheel = (tick % 10) ? 0 : (uint8_t)(tick % 20 ? 1 : -1);
+      mouseBT(x, y, wheel);
+      sumX += x; sumY += y; sumWheel += (int8_t)wheel;
+      run(UPDATE_INTERVAL);
+    }
+    uint32_t stopped = micros();
+    run(5000);   // idle: the rest is flushed
+    MouseTotal t = mouseFrames();
+    long flushed = (long)t.last - (long)stopped;   // <= 0: nothing was left when the movement stopped
+    printf("AT BI %2d: %3d reports in 2 s, min. gap %.1f ms, rest flushed %.0f ms after the last movement\n",
+           interval, t.reports, t.minGap / 1000.0, flushed > 0 ? flushed / 1000.0 : 0.0);
+    CHECK_EQ(t.x, sumX);
+    CHECK_EQ(t.y, sumY);
+    CHECK_EQ(t.wheel, sumWheel);
+    CHECK(t.minGap + 1000 >= (uint32_t)interval * 1000);   // reports are sent at millisecond resolution
+    CHECK_EQ(btAccuX, 0);
+    CHECK_EQ(btAccuY, 0);
+    CHECK_EQ(btAccuScroll, 0);
+  }
+
+  // a small movement is sent within one interval although no further movement follows
+  run(100);
+  mouseFrames();
+  unsigned long start = micros();
+  mouseBT(3, -2, 0);
+  run(btMouseInterval + 2);
+  MouseTotal t = mouseFrames();
+  CHECK_EQ(t.reports, 1);
+  CHECK_EQ(t.x, 3);
+  CHECK_EQ(t.y, -2);
+  CHECK(t.last - start <= (uint32_t)(btMouseInterval + 2) * 1000);
+
+  // large movement: saturated reports, one per interval, the remainder is carried over
+  mouseBT(1000, -500, 0);
+  run(btMouseInterval * 10);
+  t = mouseFrames();
+  CHECK_EQ(t.reports, 8);   // 7 * 127 + 111
+  CHECK_EQ(t.x, 1000);
+  CHECK_EQ(t.y, -500);
+
+  // button changes are sent at once, together with the pending movement, nothing is lost
+  mouseBT(200, 0, 0);
+  mouseBTPress(1);
+  run(1);
+  t = mouseFrames();
+  CHECK_EQ(t.reports, 1);
+  CHECK_EQ(t.x, 127);
+  mouseBTRelease(1);
+  run(btMouseInterval * 3);
+  t = mouseFrames();
+  CHECK_EQ(t.x, 73);
+  CHECK_EQ(btAccuX, 0);
+
+  // the same through the HID layer: pending scroll steps are passed before a button change
+  slotSettings.bt = 2;
+  run(5);
+  mouseFrames();
+  mouseScroll(100);
+  mouseScroll(100);
+  mousePress(MOUSE_LEFT);
+  run(1);
+  uint8_t buttons = 0;
+  int8_t wheel = 0;
+  for (AddonFrame & f : addon.frames)
+    if (f.type == BT_MSG_MOUSE) { buttons = f.payload[0]; wheel = (int8_t)f.payload[3]; break; }
+  CHECK_EQ(buttons, MOUSE_LEFT);
+  CHECK_EQ(wheel, 127);
+  mouseRelease(MOUSE_LEFT);
+  run(btMouseInterval * 3);
+  t = mouseFrames();
+  CHECK_EQ(t.wheel, 200);
+  CHECK_EQ(btAccuScroll, 0);
+  slotSettings.bt = 1;
+
+  return (TEST_RESULT());
+}
@@ -0,0 +1,125 @@
+/*
+   BT report scheduler: with continuous mouse movement and joystick axis updates at the default baud rate
+   (115200, the UART wire time is modelled by the DMA stand-in), clicks and key presses must not wait behind
+   movement reports. Axis updates are merged into the latest value, the queueing delay per priority class
+   is reported by AT ST.
+*/
+#include "FlipWare.h"
+#include "bluetooth.h"
+#include "btaddon.h"
+#include "testutil.h"
+
+void setup();
+void loop();
+
+#define TEST_KEY  (136 + 0x3A)   // F1 (non-printing key, independent of the keyboard layout)
+
+static BTAddon addon;
+
+static void run(int ms)
+{
+  for (int i = 0; i < ms; i++) {
+    loop();
+    addon.service();
+  }
+}
+
+/**
+   @return time (micros) of the first frame of the given type received at or after since which matches,
+           0 if there is none
+*/
+template <typename Match> static uint32_t firstFrame(uint8_t type, uint32_t since, Match match)
+{
+  for (AddonFrame & f : addon.frames)
+    if ((f.type == type) && ((int32_t)(f.time - since) >= 0) && match(f)) return (f.time);
+  return (0);
+}
+
+int main()
+{
+  setup();
+  for (int i = 0; i < 5; i++) loop();
+  hostReset();
+
+  // framed addon which stays at the default baud rate
+  addon.refusedRates = BT_BAUDRATES;
+  btProtocol = BT_PROTOCOL_LEGACY;
+  hostAuxOutput();
+  sendBTCommand("$FP");
+  run(2000);
+  CHECK_EQ(btProtocol, BT_PROTOCOL_FRAMED);
+  CHECK_EQ(Serial2.baudrate, BT_DEFAULT_BAUDRATE);
+  addon.frames.clear();
+  memset(btStatistics.queuedReports, 0, sizeof(btStatistics.queuedReports));
+  memset(btStatistics.queueDelayMax, 0, sizeof(btStatistics.queueDelayMax));
+  memset(btStatistics.queueDelayTotal, 0, sizeof(btStatistics.queueDelayTotal));
+
+  // 5 seconds of movement every update and axis updates every millisecond (more than the UART can send),
+  // a click or key press every 200 ms
+  std::vector<uint32_t> clicks, releases, keys;
+  int axisUpdates = 0, axis = 0;
+  for (int tick = 0; tick < 5000 / UPDATE_INTERVAL; tick++) {
+    mouseBT(40 + testNoise(30), testNoise(30), 0);
+    switch (tick % 25) {
+      case 3: clicks.push_back(micros()); mouseBTPress(MOUSE_LEFT); break;
+      case 5: releases.push_back(micros()); mouseBTRelease(MOUSE_LEFT); break;
+      case 15: keys.push_back(micros()); keyboardBTPress(TEST_KEY); break;
+      case 17: keyboardBTRelease(TEST_KEY); break;
+    }
+    for (int i = 0; i < UPDATE_INTERVAL; i++) {
+      axis = testNoise(32000);
+      joystickBTAxis16(axis, -axis, 0);
+      axisUpdates++;
+      run(1);
+    }
+  }
+  run(100);
+
+  // latency of clicks and key presses: from the call until the frame was received by the addon
+  uint32_t maxClick = 0, maxKey = 0, missing = 0;
+  for (uint32_t t : clicks) {
+    uint32_t rx = firstFrame(BT_MSG_MOUSE, t, [](AddonFrame & f) { return (f.payload[0] & MOUSE_LEFT) != 0; });
+    if (!rx) missing++;
+    else maxClick = max(maxClick, rx - t);
+  }
+  for (uint32_t t : releases) {
+    uint32_t rx = firstFrame(BT_MSG_MOUSE, t, [](AddonFrame & f) { return (f.payload[0] & MOUSE_LEFT) == 0; });
+    if (!rx) missing++;
+    else maxClick = max(maxClick, rx - t);
+  }
+  for (uint32_t t : keys) {
+    uint32_t rx = firstFrame(BT_MSG_KEYBOARD, t, [](AddonFrame & f) { return f.payload.find((char)0x3A) != std::string::npos; });
+    if (!rx) missing++;
+    else maxKey = max(maxKey, rx - t);
+  }
+  int joystickFrames = 0, mouseFrames = 0;
+  AddonFrame * lastJoystick = nullptr;
+  for (AddonFrame & f : addon.frames) {
+    if (f.type == BT_MSG_JOYSTICK) { joystickFrames++; lastJoystick = &f; }
+    if (f.type == BT_MSG_MOUSE) mouseFrames++;
+  }
+  printf("%d mouse / %d joystick frames (%d axis updates), click latency max. %.1f ms, key latency max. %.1f ms\n",
+         mouseFrames, joystickFrames, axisUpdates, maxClick / 1000.0, maxKey / 1000.0);
+
+  // statistics of the queueing delay (AT ST)
+  hostSerialOutput();
+  hostSerialInput("AT ST\r\n");
+  run(5);
+  std::string stats = hostSerialOutput();
+  size_t pos = stats.find("STATISTICS:BT queue");
+  printf("%s", pos != std::string::npos ? stats.substr(pos, stats.find('\n', pos) + 1 - pos).c_str() : "no queue statistics\n");
+  CHECK(pos != std::string::npos);
+
+  CHECK_EQ(missing, 0);
+  // one running frame and the own frame on the wire (up to 1.7 ms each) plus one loop pass
+  CHECK(maxClick <= 4500);
+  CHECK(maxKey <= 4500);
+  CHECK(joystickFrames < axisUpdates);   // merged
+  CHECK(lastJoystick && ((int8_t)lastJoystick->payload[0] == (int8_t)map(constrain(512 + axis / 64, 0, 1023), 0, 1023, -127, 127)));
+  CHECK(btStatistics.queuedReports[BT_PRIORITY_HIGH] >= clicks.size() + releases.size() + 2 * keys.size());
+  CHECK(btStatistics.queueDelayMax[BT_PRIORITY_HIGH] < 3000);
+  CHECK(btStatistics.queuedReports[BT_PRIORITY_LOW] > 0);
+  CHECK(btStatistics.queueDelayMax[BT_PRIORITY_LOW] < (uint32_t)btMouseInterval * 1000 + 5000);
+
+  return (TEST_RESULT());
+}
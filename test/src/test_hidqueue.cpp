@@ -0,0 +1,115 @@
+/*
+   Key and button event queues: throughput of key actions (updateKey) with 1 ms USB polling, press / release
+   order, and overflow of the typing buffer and the transport queue (presses may be dropped, releases are
+   never lost: no key or button stays pressed).
+*/
+#include "FlipWare.h"
+#include "keys.h"
+#include "host.h"
+#include "testutil.h"
+#include <set>
+
+void setup();
+void loop();
+void updateKey(int key, uint8_t keyAction);
+
+static void run(int ms)
+{
+  for (int i = 0; i < ms; i++) loop();
+}
+
+/**
+   replays the recorded key events
+   @return keys which are still pressed, order is cleared if a key was released which was not pressed
+*/
+static std::set<uint8_t> pressedKeys(bool * order)
+{
+  std::set<uint8_t> pressed;
+  *order = true;
+  for (auto & e : host.keyEvents) {
+    if (e.pressed) pressed.insert(e.key);
+    else if (!e.key) pressed.clear();
+    else if (!pressed.erase(e.key)) *order = false;
+  }
+  return (pressed);
+}
+
+int main()
+{
+  setup();
+  for (int i = 0; i < 5; i++) loop();
+  hostReset();
+  host.usbInterval = 1000;   // full speed HID endpoint, polled every millisecond
+
+  // throughput: press and release of 100 keys (fits into the typing buffer)
+  bool order;
+  host.keyEvents.clear();
+  for (int i = 0; i < 100; i++) {
+    updateKey('a' + i % 26, KEY_PRESS);
+    updateKey('a' + i % 26, KEY_RELEASE);
+  }
+  run(1000);
+  unsigned long first = host.keyEvents.front().time, last = host.keyEvents.back().time;
+  printf("100 keys pressed and released in %.0f ms: %.0f keys per second\n", (last - first) / 1000.0f,
+         100 * 1e6f / (last - first));
+  CHECK_EQ(host.keyEvents.size(), 200);
+  CHECK(pressedKeys(&order).empty());
+  CHECK(order);
+  CHECK(100 * 1e6f / (last - first) > 450);
+
+  // burst beyond the typing buffer: presses are rejected, all releases are performed
+  // (releases of rejected presses are harmless, so the order is not checked here)
+  hostSerialOutput();
+  host.keyEvents.clear();
+  uint32_t dropped = hidStatistics.typingDropped;
+  for (int i = 0; i < 1000; i++) {
+    updateKey('a' + i % 26, KEY_PRESS);
+    if (i % 3 == 0) updateKey(KEY_LEFT_SHIFT, KEY_PRESS);
+    updateKey('a' + i % 26, KEY_RELEASE);
+    if (i % 3 == 0) updateKey(KEY_LEFT_SHIFT, KEY_RELEASE);
+  }
+  run(5000);
+  std::set<uint8_t> stuck = pressedKeys(&order);
+  printf("1000 keys in a burst: %zu key events, %lu presses rejected, %zu keys stuck\n", host.keyEvents.size(),
+         (unsigned long)(hidStatistics.typingDropped - dropped), stuck.size());
+  CHECK(hidStatistics.typingDropped > dropped);
+  CHECK(stuck.empty());
+  CHECK(hostSerialOutput().find("E: keyboard buffer full") != std::string::npos);
+
+  // transport queue overflow while the USB endpoint is busy: mouse and joystick buttons are released
+  uint32_t queueDropped = hidTransportStatistics[HID_TRANSPORT_USB].dropped;
+  host.usbReady = false;
+  for (int i = 0; i < 3 * HID_EVENT_QUEUE_SIZE; i++) {
+    mousePress(MOUSE_LEFT);
+    mouseRelease(MOUSE_LEFT);
+    joystickButton(1 + i % 32, 1);
+    joystickButton(1 + i % 32, 0);
+  }
+  mousePress(MOUSE_RIGHT);
+  host.usbReady = true;
+  run(1000);
+  flushHIDReports();
+  printf("transport queue overflow: %lu events dropped, mouse buttons %d, joystick buttons %08x\n",
+         (unsigned long)(hidTransportStatistics[HID_TRANSPORT_USB].dropped - queueDropped), Mouse.buttons, Joystick.buttons);
+  CHECK(hidTransportStatistics[HID_TRANSPORT_USB].dropped > queueDropped);
+  CHECK_EQ(Mouse.buttons & MOUSE_LEFT, 0);
+  CHECK_EQ(Joystick.buttons, 0);
+
+  // the same with only releases queued: replaced by one release of everything
+  mousePress(MOUSE_LEFT);
+  joystickButton(5, 1);
+  run(10);
+  CHECK_EQ(Mouse.buttons, MOUSE_LEFT | MOUSE_RIGHT);
+  host.usbReady = false;
+  for (int i = 0; i < 2 * HID_EVENT_QUEUE_SIZE; i++) mouseRelease(MOUSE_MIDDLE);
+  mouseRelease(MOUSE_LEFT);
+  mouseRelease(MOUSE_RIGHT);
+  joystickButton(5, 0);
+  host.usbReady = true;
+  run(1000);
+  flushHIDReports();
+  CHECK_EQ(Mouse.buttons, 0);
+  CHECK_EQ(Joystick.buttons, 0);
+
+  return (TEST_RESULT());
+}
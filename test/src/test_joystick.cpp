@@ -0,0 +1,118 @@
+/*
+   Joystick response curves (AT CX / AT CY / AT CP, AT JM): the integer interpolation of the lookup tables
+   against the exact curves, monotony and symmetry, saturation, and the resolution of small deflections
+   with 16 bit axes (AT JM 1) compared to the 10 bit path (AT JM 0), and the conversion of axis values
+   to the USB report range.
+*/
+#include "FlipWare.h"
+#include "modes.h"
+#include "host.h"
+#include "testutil.h"
+#include <set>
+
+void setup();
+void loop();
+float responseCurve(uint8_t curve, float x);
+int32_t scaleJoystickAxis(int32_t val, const uint16_t * curve);
+void stickJoystickAxes(uint8_t select);
+extern uint16_t joystickCurveX[], joystickCurveY[];
+
+static void command(const char * line)
+{
+  hostSerialInput(line);
+  for (int i = 0; i < 5; i++) loop();
+  hostSerialOutput();
+}
+
+/**
+   @return USB joystick x axis for the given deflection * acceleration (as in joystick stick mode)
+*/
+static int usbAxis(int32_t val)
+{
+  slotSettings.ax = 1;
+  sensorData.x = val;
+  sensorData.y = 0;
+  stickJoystickAxes(0);
+  flushHIDReports();
+  return (Joystick.axes[0]);
+}
+
+int main()
+{
+  setup();
+  for (int i = 0; i < 5; i++) loop();
+  hostReset();
+
+  // lookup table vs. exact curve, for all inputs
+  struct { const char * cmd; uint8_t curve; } curves[] = {
+    {"AT CX 0\r\n", 0}, {"AT CX 30\r\n", 30}, {"AT CX 100\r\n", 100}, {"AT CX 150\r\n", 150}, {"AT CX 200\r\n", 200},
+    {"AT CX 255\r\n", 255}
+  };
+  command("AT CP 0 5 10 20 35 50 65 85 100\r\n");
+  for (auto & c : curves) {
+    command(c.cmd);
+    CHECK_EQ(slotSettings.cx, c.curve);
+    int32_t maxError = 0, last = 0;
+    bool monotonic = true, symmetric = true;
+    for (int32_t val = 0; val <= JOYSTICK_FULLSCALE + 1000; val++) {
+      int32_t axis = scaleJoystickAxis(val, joystickCurveX);
+      float x = val < JOYSTICK_FULLSCALE ? (float)val / JOYSTICK_FULLSCALE : 1.0f;
+      int32_t exact = (int32_t)(constrain(responseCurve(c.curve, x), 0.0f, 1.0f) * JOYSTICK_AXIS_MAX + 0.5f);
+      if (abs(axis - exact) > maxError) maxError = abs(axis - exact);
+      if (axis < last) monotonic = false;
+      if (scaleJoystickAxis(-val, joystickCurveX) != -axis) symmetric = false;
+      last = axis;
+    }
+    printf("curve %3d: max. deviation from the exact curve %d (%.2f%% of full scale)\n", c.curve, maxError,
+           100.0f * maxError / JOYSTICK_AXIS_MAX);
+    CHECK(maxError * 200 < JOYSTICK_AXIS_MAX);   // < 0.5 %
+    CHECK(monotonic);
+    CHECK(symmetric);
+    CHECK_EQ(last, JOYSTICK_AXIS_MAX);          // saturates at full deflection
+    if (c.curve == 0) CHECK(maxError <= 1);     // linear: exact up to rounding
+  }
+  CHECK_EQ(scaleJoystickAxis(INT32_MAX / 2, joystickCurveX), JOYSTICK_AXIS_MAX);
+  CHECK_EQ(scaleJoystickAxis(-INT32_MAX / 2, joystickCurveX), -JOYSTICK_AXIS_MAX);
+
+  // the y axis has its own table
+  command("AT CY 0\r\n");
+  CHECK(scaleJoystickAxis(JOYSTICK_FULLSCALE / 4, joystickCurveX) != scaleJoystickAxis(JOYSTICK_FULLSCALE / 4, joystickCurveY));
+
+  // resolution of small deflections (first 10 % of the range, expo curve): distinct USB axis values
+  command("AT CX 50\r\n");
+  std::set<int> levels10, levels16;
+  for (int32_t val = 0; val <= JOYSTICK_FULLSCALE / 10; val++) {
+    slotSettings.jm = 0;
+    levels10.insert(usbAxis(val));
+    slotSettings.jm = 1;
+    int axis = usbAxis(val);
+    levels16.insert(axis);
+    CHECK_EQ(axis, scaleJoystickAxis(val, joystickCurveX));
+  }
+  printf("first 10%% of the deflection: %zu axis values with AT JM 0, %zu with AT JM 1\n", levels10.size(), levels16.size());
+  CHECK(levels16.size() > 10 * levels10.size());
+
+  // conversion to the USB report range: 16 bit values are limited to -32767..32767 (-32768 leaves the axis
+  // unchanged), 10 bit values are mapped to the full range
+  struct { int32_t in, out; } axis16[] = {
+    {0, 0}, {1000, 1000}, {-1000, -1000}, {32767, 32767}, {-32767, -32767}, {32768, 32767}, {-32769, -32767},
+    {100000, 32767}, {-100000, -32767}, {INT32_MAX, 32767}, {INT32_MIN, -32767}
+  };
+  for (auto & a : axis16) {
+    joystickAxis16(1234, a.in, 0);
+    flushHIDReports();
+    CHECK_EQ(Joystick.axes[1], a.out);
+    joystickAxis16(JOYSTICK_AXIS_UNCHANGED, 0, 0);   // x stays
+    flushHIDReports();
+    CHECK_EQ(Joystick.axes[0], 1234);
+    CHECK_EQ(Joystick.axes[1], 0);
+  }
+  struct { int in, out; } axis10[] = {{0, -32767}, {1023, 32767}, {-50, -32767}, {2000, 32767}};
+  for (auto & a : axis10) {
+    joystickAxis(a.in, -1, 1);
+    flushHIDReports();
+    CHECK_EQ(Joystick.axes[2], a.out);
+  }
+
+  return (TEST_RESULT());
+}
@@ -0,0 +1,84 @@
+/*
+   Replay test for sip/puff onset detection (AT PO): detection latency of normal sips / puffs with
+   settled (po=0) and predictive (po=1) onset, and normal actions triggered by strong puffs (false positives).
+   The pressure traces are synthetic (first order rise to a plateau with sensor noise, as seen with the
+   MPRLS sensor), the sip/puff state machine of handleUserInteraction() runs unchanged.
+*/
+#include "FlipWare.h"
+#include "modes.h"
+#include "host.h"
+#include "testutil.h"
+
+void setup();
+extern uint8_t strongSipPuffState;
+
+struct OnsetResult {
+  float latency;       // mean updates from the start of the sip / puff until the action was performed
+  int missed;          // normal sip / puff without action
+  int falsePositives;  // normal puff action during a strong puff
+};
+
+/**
+   replays one sip / puff: rise with time constant tau (updates) to 512 + amplitude, hold, release
+   @return update of the press action (-1: no press), strongEntered is set if the strong mode was entered
+*/
+static int replayBlow(int amplitude, int tau, int button, bool * strongEntered)
+{
+  int pressTick = -1;
+  *strongEntered = false;
+  for (int i = 0; i < 360; i++) {
+    float level = i < 60 ? amplitude * (1 - expf(-(float)i / tau)) : amplitude * expf(-(float)(i - 60) / 4);
+    sensorData.pressure = 512 + (int)level + testNoise(2);
+    handleUserInteraction();
+    if ((pressTick < 0) && (buttonStates & (1UL << button))) pressTick = i;
+    if (strongSipPuffState != STRONG_MODE_IDLE) *strongEntered = true;
+  }
+  return (pressTick);
+}
+
+static OnsetResult replay(uint8_t po)
+{
+  static const int amplitudes[] = {130, 160, 200, 230};
+  static const int taus[] = {2, 4, 8, 12};
+  OnsetResult result = {0, 0, 0};
+  int detected = 0;
+  bool strong;
+
+  slotSettings.po = po;
+  for (int sign = 1; sign >= -1; sign -= 2) {
+    int button = sign > 0 ? PUFF_BUTTON : SIP_BUTTON;
+    for (int amplitude : amplitudes)
+      for (int tau : taus) {
+        int tick = replayBlow(sign * amplitude, tau, button, &strong);
+        if (tick < 0) result.missed++;
+        else { result.latency += tick; detected++; }
+      }
+  }
+  // strong puffs must not trigger the normal puff action
+  for (int tau : taus) {
+    if ((replayBlow(400, tau, PUFF_BUTTON, &strong) >= 0) || !strong) result.falsePositives++;
+  }
+  if (detected) result.latency /= detected;
+  return (result);
+}
+
+int main()
+{
+  setup();
+  slotSettings.stickMode = STICKMODE_ALTERNATIVE;   // no mouse movement from the (zero) x/y values
+
+  OnsetResult settled = replay(ONSET_SETTLED);
+  OnsetResult predictive = replay(ONSET_PREDICTIVE);
+  printf("po=0: latency %.1f updates (%.0f ms), missed %d, false positives %d\n", settled.latency,
+         settled.latency * UPDATE_INTERVAL, settled.missed, settled.falsePositives);
+  printf("po=1: latency %.1f updates (%.0f ms), missed %d, false positives %d\n", predictive.latency,
+         predictive.latency * UPDATE_INTERVAL, predictive.missed, predictive.falsePositives);
+
+  CHECK_EQ(settled.missed, 0);
+  CHECK_EQ(predictive.missed, 0);
+  CHECK_EQ(settled.falsePositives, 0);
+  CHECK_EQ(predictive.falsePositives, 0);
+  CHECK(predictive.latency < settled.latency);
+
+  return (TEST_RESULT());
+}
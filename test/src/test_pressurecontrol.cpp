@@ -0,0 +1,104 @@
+/*
+   Continuous pressure control (AT PA): while the pressure is bound to scroll, slider or speed, normal and
+   strong sips / puffs must not perform their actions; the slider can not be shared with the slider
+   joystick mode (AT MM 4).
+*/
+#include "FlipWare.h"
+#include "modes.h"
+#include "host.h"
+#include "testutil.h"
+
+void setup();
+void loop();
+extern uint8_t strongSipPuffState;
+
+static std::string command(const char * line)
+{
+  hostSerialOutput();
+  hostSerialInput(line);
+  for (int i = 0; i < 5; i++) loop();
+  return (hostSerialOutput());
+}
+
+static int wheelSteps()
+{
+  int steps = 0;
+  for (auto & r : host.mouseReports) steps += r.wheel;
+  host.mouseReports.clear();
+  return (steps);
+}
+
+/**
+   blows with the given amplitude (rise, hold, release)
+   @return 1 if the sip or puff button was pressed or a strong mode was entered
+*/
+static int blow(int amplitude)
+{
+  int triggered = 0;
+  for (int i = 0; i < 360; i++) {
+    sensorData.pressure = 512 + (i < 100 ? amplitude : 0);
+    handleUserInteraction();
+    flushHIDReports();
+    if (buttonStates & ((1UL << PUFF_BUTTON) | (1UL << SIP_BUTTON))) triggered = 1;
+    if (strongSipPuffState != STRONG_MODE_IDLE) triggered = 1;
+    hostAdvance(UPDATE_INTERVAL * 1000);
+  }
+  return (triggered);
+}
+
+int main()
+{
+  setup();
+  for (int i = 0; i < 5; i++) loop();
+  hostReset();
+
+  slotSettings.stickMode = STICKMODE_ALTERNATIVE;
+  sensorData.x = sensorData.y = 0;
+
+  // without pressure control: sip, puff and strong puff are detected
+  slotSettings.pa = PRESSURECONTROL_OFF;
+  CHECK(blow(200));
+  CHECK(blow(-200));
+  CHECK(blow(400));
+
+  // with pressure control: no sip / puff actions, the pressure scrolls
+  static const uint8_t modes[] = {PRESSURECONTROL_SCROLL, PRESSURECONTROL_SLIDER, PRESSURECONTROL_SPEED};
+  for (uint8_t pa : modes) {
+    slotSettings.pa = pa;
+    wheelSteps();
+    CHECK(!blow(200));
+    int up = wheelSteps();
+    CHECK(!blow(-200));
+    int down = wheelSteps();
+    CHECK(!blow(400));
+    CHECK(!blow(-400));
+    if (pa == PRESSURECONTROL_SCROLL) {
+      printf("AT PA 1: puff %d, sip %d scroll steps\n", up, down);
+      CHECK(up < 0);     // puff scrolls up
+      CHECK(down > 0);
+    }
+  }
+
+  // a sip / puff which is held when pressure control is switched on is released
+  slotSettings.pa = PRESSURECONTROL_OFF;
+  sensorData.pressure = 712;
+  for (int i = 0; i < 20; i++) handleUserInteraction();
+  CHECK(buttonStates & (1UL << PUFF_BUTTON));
+  slotSettings.pa = PRESSURECONTROL_SCROLL;
+  handleUserInteraction();
+  CHECK(!(buttonStates & (1UL << PUFF_BUTTON)));
+  sensorData.pressure = 512;
+  slotSettings.pa = PRESSURECONTROL_OFF;
+
+  // the left slider follows either the stick (AT MM 4) or the pressure (AT PA 2)
+  command("AT MM 4\r\n");
+  CHECK(command("AT PA 2\r\n").find("E: ") != std::string::npos);
+  CHECK_EQ(slotSettings.pa, PRESSURECONTROL_OFF);
+  command("AT MM 2\r\n");
+  CHECK(command("AT PA 2\r\n").find("E: ") == std::string::npos);
+  CHECK_EQ(slotSettings.pa, PRESSURECONTROL_SLIDER);
+  CHECK(command("AT MM 4\r\n").find("E: ") != std::string::npos);
+  CHECK_EQ(slotSettings.stickMode, STICKMODE_JOYSTICK_XY);
+
+  return (TEST_RESULT());
+}
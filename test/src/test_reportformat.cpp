@@ -0,0 +1,41 @@
+/*
+   Report format (AT RF): VALUES reports have the 19 buttons of v3.6 unless the extended format
+   with the pressure level buttons was selected.
+*/
+#include "FlipWare.h"
+#include "reporting.h"
+#include "host.h"
+#include "testutil.h"
+
+void setup();
+void loop();
+
+/**
+   @return button field of the next VALUES report (8th field)
+*/
+static std::string valuesButtons()
+{
+  hostSerialOutput();
+  for (int i = 0; i < 100; i++) loop();
+  std::string out = hostSerialOutput();
+  size_t pos = out.find("VALUES:");
+  if (pos == std::string::npos) return ("");
+  for (int field = 0; field < 7; field++) pos = out.find(',', pos) + 1;
+  return (out.substr(pos, out.find(',', pos) - pos));
+}
+
+int main()
+{
+  setup();
+  for (int i = 0; i < 5; i++) loop();
+  hostReset();
+
+  hostSerialInput("AT SR\r\n");
+  CHECK_EQ(valuesButtons().size(), NUMBER_OF_LEGACY_BUTTONS);
+  hostSerialInput("AT RF 1\r\n");
+  CHECK_EQ(valuesButtons().size(), NUMBER_OF_BUTTONS);
+  hostSerialInput("AT RF 0\r\n");
+  CHECK_EQ(valuesButtons().size(), NUMBER_OF_LEGACY_BUTTONS);
+
+  return (TEST_RESULT());
+}
@@ -0,0 +1,97 @@
+/*
+   Scroll stick mode (AT MM 5): the vertical deflection is mapped to a scroll velocity, fractional steps are
+   accumulated between updates. Checks that slow scrolling produces evenly spaced single steps, that no steps
+   are lost at any speed (also beyond the report range) and that the accumulator is cleared at rest.
+*/
+#include "FlipWare.h"
+#include "modes.h"
+#include "host.h"
+#include "testutil.h"
+
+void setup();
+void loop();
+void handleMovement();
+
+struct ScrollResult {
+  int steps;          // sum of all wheel values
+  int reports;        // reports with wheel movement
+  int maxStep;        // largest wheel value of one report
+  int maxGap;         // largest number of updates between two wheel reports
+  int minGap;         // smallest number of updates between two wheel reports
+};
+
+/**
+   holds the stick at the given vertical deflection for the given number of updates
+*/
+static ScrollResult scroll(int y, int updates)
+{
+  ScrollResult r = {0, 0, 0, 0, INT32_MAX};
+  int lastReport = -1;
+
+  host.mouseReports.clear();
+  sensorData.y = y;
+  for (int i = 0; i < updates; i++) {
+    size_t before = host.mouseReports.size();
+    handleMovement();
+    flushHIDReports();
+    for (size_t n = before; n < host.mouseReports.size(); n++) {
+      int wheel = host.mouseReports[n].wheel;
+      if (!wheel) continue;
+      r.steps += wheel;
+      r.reports++;
+      if (abs(wheel) > r.maxStep) r.maxStep = abs(wheel);
+      if (lastReport >= 0) {
+        if (i - lastReport > r.maxGap) r.maxGap = i - lastReport;
+        if (i - lastReport < r.minGap) r.minGap = i - lastReport;
+      }
+      lastReport = i;
+    }
+    hostAdvance(UPDATE_INTERVAL * 1000);
+  }
+  return (r);
+}
+
+int main()
+{
+  setup();
+  for (int i = 0; i < 5; i++) loop();
+  hostReset();
+
+  slotSettings.stickMode = STICKMODE_SCROLL;
+  slotSettings.pa = PRESSURECONTROL_OFF;
+  slotSettings.ay = 60;
+  sensorData.x = 0;
+
+  // slow scrolling: one step every few updates, evenly spaced (no bursts)
+  static const int deflections[] = {50, 100, 200, 400, -100};
+  for (int y : deflections) {
+    scroll(0, 1);
+    float perUpdate = (float)y * slotSettings.ay / SCROLL_SPEED_DIVIDER;
+    ScrollResult r = scroll(y, 1000);
+    int expected = (int)(perUpdate * 1000);
+    printf("y=%4d: %.3f steps / update, %4d steps in %d reports, max. step %d, gap %d-%d updates\n",
+           y, perUpdate, r.steps, r.reports, r.maxStep, r.minGap, r.maxGap);
+    CHECK(abs(r.steps - expected) <= 1);
+    CHECK((r.steps > 0) == (y > 0));
+    if (fabsf(perUpdate) < 1) {
+      CHECK_EQ(r.maxStep, 1);
+      CHECK(r.maxGap - r.minGap <= 1);   // constant rate
+    }
+  }
+
+  // very fast scrolling: the report range is exceeded, nothing is lost
+  scroll(0, 1);
+  ScrollResult fast = scroll(200000, 10);   // 150 steps per update
+  CHECK_EQ(fast.maxStep, 127);
+  ScrollResult rest = scroll(0, 10);        // remaining steps of the transport follow
+  printf("150 steps / update: %d steps in %d reports\n", fast.steps + rest.steps, fast.reports + rest.reports);
+  CHECK_EQ(fast.steps + rest.steps, 1500);
+
+  // at rest the fraction is cleared: no late step after the stick returned to the center
+  scroll(0, 1);
+  scroll(100, 10);    // 0.075 steps / update: 0.75 accumulated
+  ScrollResult idle = scroll(0, 100);
+  CHECK_EQ(idle.steps, 0);
+
+  return (TEST_RESULT());
+}
@@ -0,0 +1,182 @@
+/*
+   Sequenced command lines ("#<seq> AT ...", cumulative ACK, NAK codes) and an upload benchmark:
+   10 slots are streamed to the device with stop-and-wait (window 1) and with a sliding window,
+   with and without lost lines (go-back-N resend from the last ACK).
+
+   The device side is the unchanged parser running in loop() with the fake clock, the host side is
+   simulated in this test (one USB frame, 1 ms, from the host writing a line until the device sees it).
+*/
+#include "FlipWare.h"
+#include "parser.h"
+#include "reporting.h"
+#include "host.h"
+#include "testutil.h"
+#include <string>
+#include <vector>
+
+void setup();
+void loop();
+
+#define HOST_LATENCY_US  1000   // host -> device delivery delay
+#define SLOTS            10
+
+/**
+   collects printed text (for the slot dump)
+*/
+class TextCapture : public Print {
+  public:
+    size_t write(uint8_t c) { text.push_back((char)c); return 1; }
+    using Print::write;
+    std::string text;
+};
+
+struct PendingInput {
+  uint64_t time;
+  std::string data;
+};
+
+struct UploadResult {
+  uint64_t duration;   // microseconds
+  int resent;          // lines sent more than once
+  bool complete;
+};
+
+static std::vector<std::string> slotLines(int slot)
+{
+  struct SlotSettings saved = slotSettings;
+  slotSettings.ax = 10 + slot;
+  slotSettings.ay = 20 + slot;
+  TextCapture dump;
+  printCurrentSlot(&dump);
+  slotSettings = saved;
+
+  std::vector<std::string> lines;
+  size_t pos = 0, end;
+  while ((end = dump.text.find('\n', pos)) != std::string::npos) {
+    std::string line = dump.text.substr(pos, end - pos);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.compare(0, 3, "AT ") == 0) lines.push_back(line);   // the first line is the slot name
+    pos = end + 1;
+  }
+  return (lines);
+}
+
+/**
+   streams all lines with at most window unacknowledged lines, the lines listed in lose are lost once
+*/
+static UploadResult upload(const std::vector<std::string> & lines, unsigned window, std::vector<unsigned> lose)
+{
+  UploadResult result = {0, 0, false};
+  std::vector<PendingInput> inputs;
+  std::vector<uint8_t> sent(lines.size(), 0);
+  std::string received;
+  unsigned next = 0;
+  long lastAck = -1, ackAtRewind = -1;
+  bool rewound = false;
+  uint64_t start = host.clock;
+
+  while ((lastAck < (long)lines.size() - 1) && (host.clock - start < 60000000)) {
+    // host: send lines within the window
+    while ((next < lines.size()) && (next <= lastAck + window)) {
+      if (sent[next]++) result.resent++;
+      std::string line = "#" + std::to_string(next) + " " + lines[next] + "\r\n";
+      auto lost = std::find(lose.begin(), lose.end(), next);
+      if (lost != lose.end()) lose.erase(lost);
+      else inputs.push_back({host.clock + HOST_LATENCY_US, line});
+      next++;
+    }
+
+    // USB: deliver written lines
+    for (auto it = inputs.begin(); it != inputs.end();) {
+      if (it->time <= host.clock) { hostSerialInput(it->data); it = inputs.erase(it); }
+      else ++it;
+    }
+
+    loop();   // device (advances the clock by at least 1 ms)
+
+    // host: evaluate ACK / NAK replies
+    received += hostSerialOutput();
+    size_t end;
+    while ((end = received.find('\n')) != std::string::npos) {
+      std::string line = received.substr(0, end);
+      received.erase(0, end + 1);
+      long seq, code = 0;
+      if (sscanf(line.c_str(), "ACK %ld", &seq) == 1) {
+        if (seq > lastAck) lastAck = seq;
+        if (lastAck > ackAtRewind) rewound = false;
+      }
+      else if ((sscanf(line.c_str(), "NAK %ld %ld", &seq, &code) == 2) && (code == PARSE_SEQUENCE_ERROR) && !rewound) {
+        next = lastAck + 1;   // go back to the first unacknowledged line, later sequence NAKs are stale
+        ackAtRewind = lastAck;
+        rewound = true;
+      }
+      else if ((line.compare(0, 4, "NAK ") == 0) && (code != PARSE_SEQUENCE_ERROR)) printf("unexpected reply: %s\n", line.c_str());
+    }
+  }
+  result.duration = host.clock - start;
+  result.complete = (lastAck == (long)lines.size() - 1);
+  return (result);
+}
+
+static std::string command(const char * lines)
+{
+  hostSerialOutput();
+  hostSerialInput(lines);
+  for (int i = 0; i < 5; i++) loop();
+  return (hostSerialOutput());
+}
+
+int main()
+{
+  setup();
+  for (int i = 0; i < 5; i++) loop();   // startup messages
+  hostReset();
+
+  // replies: cumulative ACK per batch, NAK codes for failed commands
+  CHECK(command("#0 AT AX 33\r\n#1 AT AY 34\r\n") == "ACK 1\r\n");
+  CHECK_EQ(slotSettings.ax, 33);
+  CHECK(command("#2 AT QQ 1\r\n") == "???\r\nNAK 2 1\r\nACK 2\r\n");   // unknown command, sequence continues
+  CHECK(command("#4 AT AX 44\r\n") == "NAK 4 3\r\n");              // line 3 lost: not performed
+  CHECK_EQ(slotSettings.ax, 33);
+  CHECK(command("#3 AT AX 43\r\n#4 AT AX 44\r\n") == "ACK 4\r\n");
+  CHECK(command("#5 AT AX 45\r\n#7 AT AX 47\r\n") == "ACK 5\r\nNAK 7 3\r\n");   // ACK before the sequence NAK
+  CHECK(command("#6 AT AX 46\r\n#7 AT AX 47\r\n") == "ACK 7\r\n");
+  CHECK_EQ(slotSettings.ax, 47);
+  CHECK(command("#7 AT AX 48\r\n") == "NAK 7 3\r\n");              // repeated line: not performed again
+  CHECK_EQ(slotSettings.ax, 47);
+  CHECK(command("#0 AT AX 50\r\n") == "ACK 0\r\n");                // 0 restarts the sequence
+  CHECK(command("AT AX 51\r\n") == "");                            // lines without prefix work as before
+  CHECK_EQ(slotSettings.ax, 51);
+  CHECK(command("#x AT AX 52\r\n") == "?\r\n");
+  CHECK(command("#1 AT DE nonexistent\r\n") == "E: not found\r\nNAK 1 4\r\nACK 1\r\n");   // command failed
+  std::string overlong = "#2 AT KW " + std::string(WORKINGMEM_SIZE, 'x') + "\r\n#3 AT AX 53\r\n";
+  CHECK(command(overlong.c_str()) == "E: command line too long\r\nNAK 2 5\r\nACK 3\r\n");
+  CHECK_EQ(slotSettings.ax, 53);
+
+  // benchmark: upload of 10 slots
+  std::vector<std::string> lines;
+  for (int slot = 0; slot < SLOTS; slot++) {
+    std::vector<std::string> s = slotLines(slot);
+    lines.insert(lines.end(), s.begin(), s.end());
+  }
+  printf("upload of %d slots, %zu lines:\n", SLOTS, lines.size());
+
+  struct { unsigned window; std::vector<unsigned> lose; } runs[] = {
+    {1, {}}, {8, {}}, {32, {}}, {32, {5, 100, 101, 600}}
+  };
+  uint64_t stopAndWait = 0, streamed = 0;
+  for (auto & run : runs) {
+    command("AT AX 0\r\n");
+    UploadResult r = upload(lines, run.window, run.lose);
+    printf("  window %2u, %zu lost: %6.1f ms, %d lines resent\n", run.window, run.lose.size(),
+           r.duration / 1000.0, r.resent);
+    CHECK(r.complete);
+    CHECK_EQ(slotSettings.ax, 10 + SLOTS - 1);   // settings of the last slot are active
+    CHECK_EQ(slotSettings.ay, 20 + SLOTS - 1);
+    if (run.window == 1) stopAndWait = r.duration;
+    if ((run.window == 32) && run.lose.empty()) streamed = r.duration;
+  }
+  CHECK(streamed * 4 < stopAndWait);
+
+  return (TEST_RESULT());
+}
@@ -0,0 +1,130 @@
+/*
+   Serial output without blocking the main loop: AT LA (10 slots) to a host which does not read and to a
+   slow host, replies keep their order, telemetry records are not split by replies when the USB endpoint
+   accepts only a part of a write.
+*/
+#include "FlipWare.h"
+#include "reporting.h"
+#include "host.h"
+#include "testutil.h"
+
+void setup();
+void loop();
+
+/**
+   runs loop() until the output contains end (or the time limit passed)
+   @return longest loop pass (microseconds)
+*/
+static uint64_t runUntil(std::string & out, const char * end, uint64_t limitMs)
+{
+  uint64_t longest = 0, start = host.clock;
+  while ((out.find(end) == std::string::npos) && (host.clock - start < limitMs * 1000)) {
+    uint64_t before = host.clock;
+    loop();
+    longest = max(longest, host.clock - before);
+    out += hostSerialOutput();
+  }
+  return (longest);
+}
+
+static std::string expectedDump()
+{
+  std::string dump;
+  for (int i = 0; i < 10; i++) {
+    char path[16];
+    sprintf(path, "/001/%02d", i);
+    std::string slot = host.files[path], filtered;
+    // v3.6 format: without the actions of the pressure level buttons 20-25
+    size_t pos = 0;
+    int skip = 0;
+    while (pos < slot.size()) {
+      size_t end = slot.find('\n', pos) + 1;
+      std::string line = slot.substr(pos, end - pos);
+      if ((line.compare(0, 6, "AT BM ") == 0) && (atoi(line.c_str() + 6) > NUMBER_OF_LEGACY_BUTTONS)) skip = 2;
+      if (skip) skip--;
+      else filtered += line;
+      pos = end;
+    }
+    dump += "Slot:" + filtered;
+  }
+  return (dump + "END\r\n");
+}
+
+int main()
+{
+  setup();
+  for (int i = 0; i < 5; i++) loop();
+  hostReset();
+
+  // 10 slots with keystrings
+  std::string out;
+  for (int i = 0; i < 10; i++) {
+    std::string cmds;
+    for (int b = 1; b <= 6; b++)
+      cmds += "AT BM 0" + std::to_string(b) + "\r\nAT KW slot " + std::to_string(i) + " button " + std::to_string(b) +
+              " types a longer text\r\n";
+    hostSerialInput(cmds + "AT SA slot" + std::to_string(i) + "\r\n");
+    for (int n = 0; n < 20; n++) loop();
+  }
+  hostSerialOutput();
+  std::string expected = expectedDump();
+  printf("AT LA: %zu bytes\n", expected.size());
+  CHECK(expected.size() > 2 * SERIAL_REPLY_BUFFER_SIZE);
+
+  // host does not read: the main loop keeps running, the dump waits
+  Serial.readRate = 1;
+  hostSerialInput("AT LA\r\nAT ID\r\n");
+  uint64_t longest = runUntil(out, "END", 3000);
+  printf("host not reading: longest loop pass %.1f ms, %zu bytes sent in 3 s\n", longest / 1000.0, out.size());
+  CHECK(longest < 2000);
+  CHECK(out.find("END") == std::string::npos);
+
+  // slow host (64 kB/s): complete dump in order, the following command is answered afterwards
+  Serial.readRate = 64000;
+  longest = max(longest, runUntil(out, "END", 5000));
+  runUntil(out, "\n", 50);
+  for (int i = 0; i < 20; i++) { loop(); out += hostSerialOutput(); }
+  printf("slow host: longest loop pass %.1f ms, discarded reply bytes %lu\n", longest / 1000.0,
+         (unsigned long)serialOutStatistics.replyDiscarded);
+  CHECK(longest < 2000);
+  CHECK(out.compare(0, expected.size(), expected) == 0);
+  CHECK(out.substr(expected.size()).find(VERSION_STRING) != std::string::npos);   // AT ID after END
+  CHECK_EQ(serialOutStatistics.replyDiscarded, 0);
+
+  // extended format: also the actions of the pressure level buttons
+  Serial.readRate = 0;
+  out.clear();
+  hostSerialInput("AT RF 1\r\nAT LA\r\n");
+  runUntil(out, "END", 1000);
+  CHECK(out.find("AT BM 25") != std::string::npos);
+  CHECK(expected.find("AT BM 25") == std::string::npos);
+  hostSerialInput("AT RF 0\r\n");
+
+  // endpoint accepts only a few bytes per write: telemetry records and replies are not mixed
+  Serial.writeChunk = 7;
+  out.clear();
+  hostSerialInput("AT RI 8\r\nAT SR\r\n");
+  for (int i = 0; i < 300; i++) {
+    if (i % 20 == 0) hostSerialInput("AT ID\r\n");
+    loop();
+    out += hostSerialOutput();
+  }
+  hostSerialInput("AT ER\r\n");
+  for (int i = 0; i < 50; i++) { loop(); out += hostSerialOutput(); }
+  Serial.writeChunk = 0;
+  int values = 0, ids = 0, broken = 0;
+  size_t pos = 0, end;
+  while ((end = out.find('\n', pos)) != std::string::npos) {
+    std::string line = out.substr(pos, end - pos);
+    if (line.compare(0, 7, "VALUES:") == 0) values++;
+    else if (line.find(VERSION_STRING) != std::string::npos) ids++;
+    else broken++;
+    pos = end + 1;
+  }
+  printf("7 bytes per write: %d VALUES reports, %d replies, %d broken lines\n", values, ids, broken);
+  CHECK(values > 10);
+  CHECK_EQ(ids, 15);
+  CHECK_EQ(broken, 0);
+
+  return (TEST_RESULT());
+}
@@ -0,0 +1,187 @@
+/*
+   Replay benchmark for the adaptive x/y filter (applySmoothing, One-Euro filter, AT FC / AT FB):
+   jitter while holding a deflection, added lag during movement, no residual movement after release,
+   and the same step response time at a different update rate (the filter uses the measured interval).
+
+   Without arguments a synthetic trace is used (rest, ramp, hold, release with sensor noise).
+   A recorded trace can be replayed with: test_smoothing <file>, one "x y" (or "x,y") pair per
+   update (UPDATE_INTERVAL) per line, e.g. the x/y fields of the VALUES reports (AT SR) minus the deadzone.
+*/
+#include "FlipWare.h"
+#include "sensors.h"
+#include "host.h"
+#include "testutil.h"
+#include <vector>
+
+struct Sample { int x, y; };
+
+struct FilterResult {
+  float jitterIn, jitterOut;   // mean absolute tick-to-tick change during steady segments
+  float lagTicks;              // mean delay of the output during movement (in updates)
+  int residual;                // non-zero outputs after the input returned to zero
+};
+
+/**
+   synthetic trace: 2 s rest, 0.5 s ramp to 120, 2 s hold, 0.25 s release, 2 s rest (x and y, +-3 noise)
+*/
+static std::vector<Sample> syntheticTrace(std::vector<uint8_t> & steady, std::vector<uint8_t> & moving)
+{
+  std::vector<Sample> trace;
+  auto add = [&](int value, bool isSteady, bool isMoving) {
+    int noise = value ? 3 : 0;   // deadzone removes the noise at rest
+    trace.push_back({value + testNoise(noise), value / 2 + testNoise(noise)});
+    steady.push_back(isSteady);
+    moving.push_back(isMoving);
+  };
+  for (int i = 0; i < 250; i++) add(0, false, false);
+  for (int i = 0; i < 62; i++) add(i * 120 / 62, false, i > 10);
+  for (int i = 0; i < 250; i++) add(120, i > 50, false);
+  for (int i = 0; i < 31; i++) add(120 - i * 120 / 31, false, false);
+  for (int i = 0; i < 250; i++) add(0, false, false);
+  return (trace);
+}
+
+static FilterResult replay(const std::vector<Sample> & trace, const std::vector<uint8_t> & steady,
+                           const std::vector<uint8_t> & moving, uint8_t fc, uint8_t fb)
+{
+  struct SlotSettings settings = defaultSlotSettings;
+  struct SensorData data = {0};
+  FilterResult result = {0, 0, 0, 0};
+  int steadyCount = 0, movingCount = 0, lastIn = 0, lastOut = 0;
+  size_t lastNonZeroInput = 0;
+
+  settings.fc = 0;     // resets the filter state
+  applySmoothing(&data, &settings);
+  settings.fc = fc;
+  settings.fb = fb;
+
+  for (size_t i = 0; i < trace.size(); i++) {
+    data.x = trace[i].x;
+    data.y = trace[i].y;
+    hostAdvance(UPDATE_INTERVAL * 1000);
+    applySmoothing(&data, &settings);
+
+    // force and angle must follow the filtered values
+    if (fc) CHECK(fabsf(data.force - sqrtf((float)data.x * data.x + (float)data.y * data.y)) < 0.01f);
+
+    if (steady[i]) {
+      result.jitterIn += abs(trace[i].x - lastIn);
+      result.jitterOut += abs(data.x - lastOut);
+      steadyCount++;
+    }
+    if (moving[i] && trace[i].x > trace[i - 1].x) {
+      // ramp: lag = distance behind the (noise free) input / slope
+      float slope = 120.0f / 62;
+      result.lagTicks += (i - 250) * slope - data.x > 0 ? ((i - 250) * slope - data.x) / slope : 0;
+      movingCount++;
+    }
+    if (trace[i].x || trace[i].y) lastNonZeroInput = i;
+    else if ((i > lastNonZeroInput + 125) && (data.x || data.y)) result.residual++;   // 1 s after release
+    lastIn = trace[i].x;
+    lastOut = data.x;
+  }
+  if (steadyCount) { result.jitterIn /= steadyCount; result.jitterOut /= steadyCount; }
+  if (movingCount) result.lagTicks /= movingCount;
+  return (result);
+}
+
+/**
+   step from 0 to 100 with the given update interval (microseconds)
+   @return time until the output reached 63% of the step (microseconds)
+*/
+static uint64_t stepTime(uint32_t interval, uint8_t fc, uint8_t fb)
+{
+  struct SlotSettings settings = defaultSlotSettings;
+  struct SensorData data = {0};
+
+  settings.fc = 0;     // filter off while the interval estimate settles
+  for (int i = 0; i < 200; i++) {
+    hostAdvance(interval);
+    applySmoothing(&data, &settings);
+  }
+  settings.fc = fc;
+  settings.fb = fb;
+  uint64_t start = host.clock;
+  while (data.x < 63) {
+    data.x = 100;
+    data.y = 0;
+    hostAdvance(interval);
+    applySmoothing(&data, &settings);
+  }
+  return (host.clock - start);
+}
+
+/**
+   replays a recorded trace and prints the mean tick-to-tick change and the mean deviation from the input
+*/
+static int replayFile(const char * name)
+{
+  FILE * f = fopen(name, "r");
+  if (!f) { printf("cannot open %s\n", name); return (1); }
+  std::vector<Sample> trace;
+  Sample s;
+  while (fscanf(f, "%d%*[ ,;\t]%d", &s.x, &s.y) == 2) trace.push_back(s);
+  fclose(f);
+
+  static const uint8_t cutoffs[] = {0, 5, 10, 20, 50};
+  printf("%zu samples (%zu ms)\n", trace.size(), trace.size() * UPDATE_INTERVAL);
+  for (uint8_t fc : cutoffs) {
+    struct SlotSettings settings = defaultSlotSettings;
+    struct SensorData data = {0};
+    settings.fc = 0;
+    applySmoothing(&data, &settings);
+    settings.fc = fc;
+    float change = 0, deviation = 0;
+    int last = 0;
+    for (const Sample & in : trace) {
+      data.x = in.x; data.y = in.y;
+      hostAdvance(UPDATE_INTERVAL * 1000);
+      applySmoothing(&data, &settings);
+      change += abs(data.x - last);
+      deviation += abs(data.x - in.x);
+      last = data.x;
+    }
+    printf("fc=%3d fb=%d: mean change per update %.2f, mean deviation from input %.2f\n",
+           fc, settings.fb, change / trace.size(), deviation / trace.size());
+  }
+  return (0);
+}
+
+int main(int argc, char ** argv)
+{
+  if (argc > 1) return (replayFile(argv[1]));
+
+  std::vector<uint8_t> steady, moving;
+  std::vector<Sample> trace = syntheticTrace(steady, moving);
+
+  FilterResult off = replay(trace, steady, moving, 0, 0);
+  printf("filter off:          jitter %.2f, lag %.2f updates, residual %d\n", off.jitterOut, off.lagTicks, off.residual);
+  CHECK(off.jitterOut == off.jitterIn);
+
+  static const uint8_t cutoffs[] = {5, 10, 20, 50};
+  for (uint8_t fc : cutoffs) {
+    FilterResult r = replay(trace, steady, moving, fc, defaultSlotSettings.fb);
+    printf("fc=%3d fb=%d: jitter %.2f -> %.2f, lag %.2f updates (%.0f ms), residual %d\n", fc, defaultSlotSettings.fb,
+           r.jitterIn, r.jitterOut, r.lagTicks, r.lagTicks * UPDATE_INTERVAL, r.residual);
+    CHECK(r.jitterOut < r.jitterIn / 2);   // noise while holding a deflection is reduced
+    CHECK_EQ(r.residual, 0);               // the cursor stops when the stick is released
+  }
+
+  // the speed term keeps the lag small during fast movements
+  FilterResult noBeta = replay(trace, steady, moving, 10, 0);
+  FilterResult beta = replay(trace, steady, moving, 10, defaultSlotSettings.fb);
+  printf("fc= 10 fb=0: lag %.2f updates, fb=%d: lag %.2f updates\n", noBeta.lagTicks, defaultSlotSettings.fb, beta.lagTicks);
+  CHECK(beta.lagTicks < noBeta.lagTicks);
+  CHECK(beta.lagTicks * UPDATE_INTERVAL < 80);
+
+  // the time constant does not depend on the update rate
+  uint64_t nominal = stepTime(UPDATE_INTERVAL * 1000, 10, 0);
+  uint64_t faster = stepTime(UPDATE_INTERVAL * 500, 10, 0);
+  uint64_t slower = stepTime(UPDATE_INTERVAL * 2000, 10, 0);
+  printf("fc= 10 fb=0: step response %.0f ms at %d ms, %.0f ms at %d ms, %.0f ms at %d ms updates\n", nominal / 1000.0,
+         UPDATE_INTERVAL, faster / 1000.0, UPDATE_INTERVAL / 2, slower / 1000.0, UPDATE_INTERVAL * 2);
+  CHECK(llabs((long long)faster - (long long)nominal) <= UPDATE_INTERVAL * 1000);
+  CHECK(llabs((long long)slower - (long long)nominal) <= UPDATE_INTERVAL * 2000);
+
+  return (TEST_RESULT());
+}
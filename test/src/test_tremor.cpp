@@ -0,0 +1,93 @@
+/*
+   Tremor notch filter (AT TF / AT TW): attenuation of a synthetic 8 Hz tremor, pass band gain and
+   delay of slow intended movements, coefficient update when the sensor sampling rate changes.
+*/
+#include "../../FLipWare/sensors.cpp"   // updateTremorFilter / applyTremorFilter are static
+#include "host.h"
+#include "testutil.h"
+
+/**
+   feeds a sine through the filter at the given sampling interval,
+   returns the output amplitude (after the filter settled) relative to the input amplitude
+*/
+static float sineGain(float freq, uint32_t interval, uint8_t tf, uint8_t tw, float * delayMs = nullptr)
+{
+  const float amplitude = 1000;
+  float peakOut = 0, lastIn = 0, lastOut = 0, inCrossing = 0, delaySum = 0;
+  int crossings = 0;
+  int samples = (int)(6000000 / interval);   // 6 seconds, the first 3 seconds are settling time
+
+  for (int i = 0; i < samples; i++) {
+    hostAdvance(interval);
+    float t = i * interval / 1000000.0f;
+    float in = amplitude * sinf(2 * PI * freq * t);
+    float out = updateTremorFilter(tf, tw) ? applyTremorFilter((int32_t)in, 0) : in;
+
+    if (t > 3.0f) {
+      if (fabsf(out) > peakOut) peakOut = fabsf(out);
+      // delay: time between rising zero crossings of input and output
+      if ((lastIn < 0) && (in >= 0)) inCrossing = t;
+      if ((lastOut < 0) && (out >= 0) && (inCrossing > 0)) { delaySum += t - inCrossing; crossings++; }
+    }
+    lastIn = in;
+    lastOut = out;
+  }
+  if (delayMs) *delayMs = crossings ? delaySum / crossings * 1000 : 0;
+  return (peakOut / amplitude);
+}
+
+static void resetFilter()
+{
+  memset(&tremorFilter, 0, sizeof(tremorFilter));
+}
+
+int main()
+{
+  static const uint32_t intervals[] = {3125, 6250};   // NAU7802 at 320 SPS, one or both channels per sample
+  for (uint32_t interval : intervals) {
+    float delayMs;
+    resetFilter();
+    float notch = sineGain(8.0f, interval, 80, 40);
+    resetFilter();
+    float pass = sineGain(1.0f, interval, 80, 40, &delayMs);
+    resetFilter();
+    float passOff = sineGain(1.0f, interval, 0, 40);
+
+    printf("%4.0f Hz sampling, notch 8 Hz / 4 Hz wide: 8 Hz %.1f dB, 1 Hz %.2f dB (delay %.1f ms)\n",
+           1000000.0f / interval, 20 * log10f(notch), 20 * log10f(pass), delayMs);
+    CHECK(20 * log10f(notch) < -20);    // tremor attenuated by more than 20 dB
+    CHECK(20 * log10f(pass) > -1);      // intended movement passes
+    CHECK(delayMs < 30);
+    CHECK(fabsf(passOff - 1.0f) < 0.01f);
+  }
+
+  // wide band (4-12 Hz) also suppresses tremor beside the center frequency
+  resetFilter();
+  float band = sineGain(6.0f, 3125, 80, 80);
+  printf("6 Hz with 8 Hz / 8 Hz wide notch: %.1f dB\n", 20 * log10f(band));
+  CHECK(20 * log10f(band) < -3);   // band edges (4 / 12 Hz) are at -3 dB
+
+  // the coefficients follow a change of the sampling rate
+  resetFilter();
+  sineGain(8.0f, 3125, 80, 40);
+  uint32_t before = tremorFilter.interval;
+  float notch = sineGain(8.0f, 6250, 80, 40);
+  printf("sampling interval %u us -> %u us, 8 Hz %.1f dB\n", before, tremorFilter.interval, 20 * log10f(notch));
+  CHECK(before != tremorFilter.interval);
+  CHECK(20 * log10f(notch) < -20);
+
+  // a single hang of the sensor does not change the coefficients
+  hostAdvance(50000);
+  updateTremorFilter(80, 40);
+  CHECK_EQ(tremorFilter.interval, 6250);
+  CHECK_EQ(tremorFilter.intervalEstimate >> 4, 6250);
+
+  // center frequency above the Nyquist limit: filter stays off
+  resetFilter();
+  hostAdvance(20000);
+  updateTremorFilter(80, 40);
+  for (int i = 0; i < 10; i++) { hostAdvance(20000); updateTremorFilter(250, 40); }
+  CHECK_EQ(tremorFilter.active, 0);
+
+  return (TEST_RESULT());
+}
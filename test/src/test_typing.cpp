@@ -0,0 +1,75 @@
+/*
+   Asynchronous typing (keyboardPrint): typing rate in characters per second, order of the typed characters,
+   and overlong text (characters beyond the typing buffer are dropped, counted and reported).
+*/
+#include "FlipWare.h"
+#include "host.h"
+#include "testutil.h"
+
+void setup();
+void loop();
+
+/**
+   runs loop() until all pressed keys of the text are released (or the time limit passed)
+   @return the typed characters (in the order of the key presses)
+*/
+static std::string typed(uint64_t limitMs)
+{
+  std::string text;
+  uint64_t start = host.clock;
+  size_t n = 0;
+  while (host.clock - start < limitMs * 1000) {
+    loop();
+    for (; n < host.keyEvents.size(); n++)
+      if (host.keyEvents[n].pressed) text += (char)host.keyEvents[n].key;
+  }
+  return (text);
+}
+
+int main()
+{
+  setup();
+  for (int i = 0; i < 5; i++) loop();
+  hostReset();
+  host.usbInterval = 1000;   // full speed HID endpoint, polled every millisecond
+
+  // typing rate of a longer text
+  std::string text;
+  for (int i = 0; text.size() < 400; i++) text += "the quick brown fox jumps over the lazy dog ";
+  text.resize(400);
+  host.keyEvents.clear();
+  keyboardPrint((char *)text.c_str());
+  std::string out = typed(5000);
+  CHECK(out == text);
+  unsigned long first = host.keyEvents.front().time, last = host.keyEvents.back().time;
+  float rate = text.size() * 1e6f / (last - first);
+  printf("%zu characters typed in %.0f ms: %.0f characters per second (%zu key events)\n", text.size(),
+         (last - first) / 1000.0f, rate, host.keyEvents.size());
+  CHECK(rate > 450);   // one report per poll: press and release of a character take about 2 ms
+
+  // overlong text: the part which fits is typed, the rest is dropped and reported
+  // (control codes of key actions are skipped, they are not counted as dropped)
+  std::string overlong;
+  for (int i = 0; i < TYPING_BUFFER_SIZE + 100; i++) overlong += (char)('a' + i % 26);
+  overlong.insert(10, "\x01\x02\x03");
+  overlong.insert(TYPING_BUFFER_SIZE + 20, "\x01\x02\x03");
+  uint32_t dropped = hidStatistics.typingDropped;
+  hostSerialOutput();
+  host.keyEvents.clear();
+  keyboardPrint((char *)overlong.c_str());
+  out = typed(5000);
+  std::string reply = hostSerialOutput();
+  printf("%s", reply.c_str());
+  CHECK_EQ(out.size(), TYPING_BUFFER_SIZE - TYPING_RELEASE_RESERVE);   // the reserve is kept for key releases
+  CHECK_EQ(hidStatistics.typingDropped - dropped, 100 + TYPING_RELEASE_RESERVE);
+  CHECK(reply.find("E: keyboard buffer full, dropped characters: " + std::to_string(100 + TYPING_RELEASE_RESERVE)) != std::string::npos);
+
+  // text which fits completely: no error
+  hostSerialOutput();
+  host.keyEvents.clear();
+  keyboardPrint((char *)"abc");
+  CHECK(typed(100) == "abc");
+  CHECK(hostSerialOutput().find("E: ") == std::string::npos);
+
+  return (TEST_RESULT());
+}
@@ -0,0 +1,27 @@
+/*
+   Minimal check macros for the host tests: failed checks are printed, main() returns the failure count
+*/
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+
+static int testFailures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond); testFailures++; } } while (0)
+
+#define CHECK_EQ(a, b) do { long long va_ = (long long)(a), vb_ = (long long)(b); if (va_ != vb_) { \
+      printf("FAILED %s:%d: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, va_, vb_); testFailures++; } } while (0)
+
+#define TEST_RESULT() (printf(testFailures ? "%d check(s) failed\n" : "all checks passed\n", testFailures), testFailures)
+
+/**
+   @name testNoise
+   @brief deterministic pseudo random noise (uniform, -amplitude..amplitude), reproducible across platforms
+*/
+static inline int testNoise(int amplitude)
+{
+  static uint32_t seed = 12345;
+  seed = seed * 1103515245UL + 12345UL;
+  return (int)((seed >> 16) % (2 * amplitude + 1)) - amplitude;
+}